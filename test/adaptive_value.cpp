@@ -0,0 +1,109 @@
+// adaptive_value picks eager cloning during the warmup and for cheap clones, sharing for expensive ones,
+// and eager cloning again when copies are mostly written to. The write share is counted over recent copies,
+// so the decision turns back within about a window of copies after the workload changes.
+
+#include "adaptive_value.hpp"
+#include "check.hpp"
+
+#include <vector>
+
+namespace
+{
+    // expensive enough to clone that sharing pays off, even in an optimized build.
+    struct large
+    {
+        std::vector <int> data = std::vector <int> (4096, 1);
+    };
+
+    struct small
+    {
+        int value = 0;
+    };
+
+    template <typename T>
+    using policy = sutil::adaptive_policy <T>;
+
+    void warmup()
+    {
+        policy <large>::instance().reset();
+        auto original = sutil::make_adaptive <large> ();
+        for (std::uint64_t i = 0; i != policy <large>::warmup_copies; ++i)
+        {
+            auto copy = original;
+            CHECK(!copy.is_shared() && copy.get() != original.get());
+        }
+        auto stats = original.statistics();
+        CHECK(stats.copies == policy <large>::warmup_copies && stats.clones == policy <large>::warmup_copies);
+        CHECK(stats.average_clone_ns >= policy <large>::cheap_clone_ns && stats.copy_on_write);
+
+        auto shared = original;
+        CHECK(shared.is_shared() && shared.get() == original.get());
+        shared.modify()->data[0] = 2;
+        CHECK(!shared.is_shared() && original->data[0] == 1);
+    }
+
+    void cheap_clones()
+    {
+        policy <small>::instance().reset();
+        auto original = sutil::make_adaptive <small> ();
+        for (std::uint64_t i = 0; i != policy <small>::warmup_copies; ++i)
+            auto copy = original;
+        // whatever the clones took here, these samples pull the average below the threshold.
+        for (int i = 0; i != 100; ++i)
+            policy <small>::instance().add_clone_sample(0);
+        CHECK(original.statistics().average_clone_ns < policy <small>::cheap_clone_ns);
+        auto copy = original;
+        CHECK(!copy.is_shared());
+    }
+
+    void write_share_decays()
+    {
+        policy <large>::instance().reset();
+        auto original = sutil::make_adaptive <large> ();
+
+        // copies that are always written to, for many windows.
+        for (std::uint64_t i = 0; i != 8 * policy <large>::copy_window; ++i)
+        {
+            auto copy = original;
+            copy.modify()->data[0] = 2;
+        }
+        auto stats = original.statistics();
+        CHECK(!stats.copy_on_write && stats.recent_write_ratio() > 0.9);
+        CHECK(stats.recent_copies < policy <large>::copy_window);
+        auto eager = original;
+        CHECK(!eager.is_shared());
+
+        // then only read. cumulative counts would take more than 2700 copies to turn.
+        std::uint64_t copies = 0;
+        bool shared = false;
+        while (!shared && copies != 2 * policy <large>::copy_window)
+        {
+            auto copy = original;
+            shared = copy.is_shared();
+            ++copies;
+        }
+        CHECK(shared);
+        stats = original.statistics();
+        CHECK(stats.write_ratio() > 0.75 && stats.recent_write_ratio() < 0.75);
+    }
+
+    void clone_average_decays()
+    {
+        policy <small>::instance().reset();
+        auto& p = policy <small>::instance();
+        p.add_clone_sample(1000);
+        CHECK(p.statistics().average_clone_ns == 1000);
+        for (int i = 0; i != 64; ++i)
+            p.add_clone_sample(8);
+        // a cumulative average would still be above 20.
+        CHECK(p.statistics().average_clone_ns < 16);
+    }
+}
+
+int main()
+{
+    warmup();
+    cheap_clones();
+    write_share_decays();
+    clone_average_decays();
+}
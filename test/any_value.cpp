@@ -0,0 +1,118 @@
+// Inline and heap placement, copies, moves and destructions of any_value, with the default policies
+// and with a cloner that creates heap objects itself.
+
+#include "any_value.hpp"
+#include "check.hpp"
+
+#include <array>
+#include <memory>
+#include <utility>
+
+namespace
+{
+    int alive = 0;
+    int constructed = 0;
+
+    template <std::size_t Size>
+    struct counted
+    {
+        std::array <unsigned char, Size> bytes;
+        int value;
+
+        explicit counted(int v) noexcept : bytes(), value(v) { ++alive; ++constructed; }
+        counted(counted const& other) noexcept : bytes(other.bytes), value(other.value) { ++alive; ++constructed; }
+        counted(counted&& other) noexcept : bytes(other.bytes), value(other.value) { ++alive; ++constructed; }
+        ~counted() { --alive; }
+    };
+
+    using small = counted <1>;
+    using large = counted <64>;
+
+    static_assert(sutil::detail::any_value_fits_inline <small>::value, "small is stored inline");
+    static_assert(!sutil::detail::any_value_fits_inline <large>::value, "large goes to the heap");
+
+    int pool_constructs = 0;
+    int pool_deletes = 0;
+
+    // creates and destroys heap objects as a pair, like owner_clone and owner_delete.
+    template <typename T>
+    struct pool_clone
+    {
+        T* operator()(T* other) const
+        {
+            return construct(*other);
+        }
+
+        template <typename... List>
+        static T* construct(List&&... list)
+        {
+            ++pool_constructs;
+            return new T(std::forward <List> (list)...);
+        }
+    };
+
+    template <typename T>
+    struct pool_delete
+    {
+        void operator()(T* p) const noexcept
+        {
+            ++pool_deletes;
+            delete p;
+        }
+    };
+
+    void placement_copy_move()
+    {
+        {
+            sutil::any_value a = small(1);
+            CHECK(a.holds <small> () && !a.is_heap_allocated() && alive == 1);
+
+            sutil::any_value b = large(2);
+            CHECK(b.holds <large> () && b.is_heap_allocated() && alive == 2);
+
+            constructed = 0;
+            sutil::any_value c = a;
+            sutil::any_value d = b;
+            CHECK(alive == 4 && constructed == 2);
+            CHECK(sutil::any_value_cast <small> (&c)->value == 1);
+            CHECK(sutil::any_value_cast <large> (d).value == 2);
+
+            // moving a heap object takes the pointer, moving an inline one relocates it.
+            large* heap = b.get_if <large> ();
+            constructed = 0;
+            sutil::any_value e = std::move(b);
+            sutil::any_value f = std::move(a);
+            CHECK(!b.has_value() && !a.has_value() && alive == 4 && constructed == 1);
+            CHECK(e.get_if <large> () == heap && f.get_if <small> ()->value == 1);
+            CHECK(!e.get_if <small> () && !sutil::any_value_cast <large> (&f));
+
+            e.swap(f);
+            CHECK(e.holds <small> () && f.get_if <large> () == heap && alive == 4);
+
+            c = d;
+            CHECK(c.holds <large> () && alive == 4);
+            d.reset();
+            CHECK(alive == 3);
+        }
+        CHECK(alive == 0);
+    }
+
+    void cloner_constructs()
+    {
+        {
+            sutil::any_value a = sutil::make_any_value <large, pool_clone <large>, pool_delete <large> > (3);
+            CHECK(a.is_heap_allocated() && pool_constructs == 1);
+            sutil::any_value b = a;
+            CHECK(pool_constructs == 2 && b.get_if <large> ()->value == 3);
+            a = small(4);
+            CHECK(pool_deletes == 1);
+        }
+        CHECK(pool_deletes == 2 && alive == 0);
+    }
+}
+
+int main()
+{
+    placement_copy_move();
+    cloner_constructs();
+}
@@ -0,0 +1,135 @@
+// Members of a make_values batch that are reset, reassigned, copied, moved between batches or handed
+// to a shared_ptr must be destroyed exactly once, and the batch must stay alive while any of its objects is.
+// Run with SUTIL_SANITIZE=ON to catch use after free and leaks as well.
+
+#include "batch_value.hpp"
+#include "check.hpp"
+
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+namespace
+{
+    int alive = 0;
+
+    struct counted
+    {
+        int value;
+
+        explicit counted(int v) : value(v) { ++alive; }
+        counted(counted const& other) : value(other.value) { ++alive; }
+        ~counted() { --alive; }
+    };
+
+    using ptr = sutil::batch_value_ptr <counted>;
+
+    void reset_and_assign()
+    {
+        {
+            auto batch = sutil::make_values <counted> (4, 1);
+            CHECK(alive == 4);
+            batch[0].reset(new counted(2));
+            batch[1] = new counted(3);
+            batch[2].reset();
+            CHECK(alive == 3);
+            batch[0].reset(new counted(4));
+            CHECK(alive == 3);
+            CHECK(batch[0]->value == 4 && batch[1]->value == 3 && batch[3]->value == 1);
+        }
+        CHECK(alive == 0);
+    }
+
+    void copies_outlive_the_batch()
+    {
+        ptr copy;
+        ptr moved;
+        {
+            auto batch = sutil::make_values <counted> (3, 5);
+            copy = batch[0];
+            moved = std::move(batch[1]);
+            CHECK(alive == 4);
+        }
+        CHECK(alive == 2);
+        CHECK(copy->value == 5 && moved->value == 5);
+        moved.reset();
+        copy.reset();
+        CHECK(alive == 0);
+    }
+
+    void handed_to_shared_ptr()
+    {
+        std::shared_ptr <counted> shared;
+        {
+            auto batch = sutil::make_values <counted> (2, 7);
+            // the shared_ptr takes over the deleter and with it the object's share of the batch.
+            shared = std::move(batch[0]).to_shared();
+        }
+        CHECK(alive == 1);
+        CHECK(shared->value == 7);
+        shared.reset();
+        CHECK(alive == 0);
+    }
+
+    void clones_do_not_keep_the_batch()
+    {
+        ptr clone;
+        {
+            auto batch = sutil::make_values <counted> (2, 8);
+            clone = batch[1];
+        }
+        // the batch is gone, the clone deletes its object on its own.
+        CHECK(alive == 1);
+        CHECK(clone->value == 8);
+        clone.reset(new counted(9));
+        CHECK(alive == 1);
+        clone.reset();
+        CHECK(alive == 0);
+    }
+
+    void reset_across_batches()
+    {
+        {
+            auto first = sutil::make_values <counted> (3, 1);
+            auto second = sutil::make_values <counted> (2, 2);
+            // objects move between batches' value_ptrs, each is destroyed in its own batch.
+            first[0].reset(second[1].release());
+            second[1].reset(first[2].release());
+            first[2].reset(new counted(3));
+            CHECK(alive == 5);
+            CHECK(first[0]->value == 2 && second[1]->value == 1 && first[2]->value == 3);
+            second.clear();
+            CHECK(alive == 3);
+            CHECK(first[0]->value == 2);
+        }
+        CHECK(alive == 0);
+    }
+
+    void size_overflow()
+    {
+        // objects so large that the batch does not fit in memory, make_values would fail to reserve its result first.
+        std::size_t const max = std::numeric_limits <std::size_t>::max();
+        bool thrown = false;
+        try
+        {
+            sutil::detail::batch_block::create(3, max / 2, 1);
+        }
+        catch (std::bad_array_new_length const&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+int main()
+{
+    reset_and_assign();
+    copies_outlive_the_batch();
+    handed_to_shared_ptr();
+    clones_do_not_keep_the_batch();
+    reset_across_batches();
+    size_overflow();
+}
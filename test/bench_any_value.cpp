@@ -0,0 +1,83 @@
+// Copy-heavy workload for any_value, against std::any and std::shared_ptr <void const>:
+// a vector of mixed small and large values is copied as a whole, again and again.
+// std::shared_ptr shares instead of copying, it is the lower bound for copying a handle.
+
+#include "any_value.hpp"
+#include "benchmark.hpp"
+
+#include <any>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct point
+    {
+        double x, y;
+    };
+
+    using big = std::array <double, 8>;
+
+    constexpr std::size_t values = 256;
+
+    template <typename HolderT, typename MakeT>
+    std::vector <HolderT> fill(MakeT make)
+    {
+        std::vector <HolderT> result;
+        result.reserve(values);
+        for (std::size_t i = 0; i != values; ++i)
+        {
+            switch (i % 4)
+            {
+                case 0: result.push_back(make(static_cast <int> (i))); break;
+                case 1: result.push_back(make(point{double(i), double(i)})); break;
+                case 2: result.push_back(make(std::string(i % 32, 'x'))); break;
+                default: result.push_back(make(big{})); break;
+            }
+        }
+        return result;
+    }
+
+    struct make_any_value
+    {
+        template <typename T>
+        sutil::any_value operator()(T value) const { return sutil::any_value(std::move(value)); }
+    };
+
+    struct make_std_any
+    {
+        template <typename T>
+        std::any operator()(T value) const { return std::any(std::move(value)); }
+    };
+
+    struct make_shared
+    {
+        template <typename T>
+        std::shared_ptr <void const> operator()(T value) const { return std::make_shared <T const> (std::move(value)); }
+    };
+
+    template <typename HolderT>
+    void copy_all(char const* name, std::size_t n, std::vector <HolderT> const& source)
+    {
+        benchmark::run(name, n, [&](std::size_t) {
+            std::vector <HolderT> copy(source);
+            benchmark::keep(copy);
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t const n = benchmark::iterations(argc, argv, 20000);
+    std::printf("copying %zu mixed values, per copy of the vector:\n", values);
+
+    auto const a = fill <sutil::any_value> (make_any_value());
+    auto const b = fill <std::any> (make_std_any());
+    auto const c = fill <std::shared_ptr <void const> > (make_shared());
+
+    copy_all("sutil::any_value", n, a);
+    copy_all("std::any", n, b);
+    copy_all("std::shared_ptr <void const>", n, c);
+}
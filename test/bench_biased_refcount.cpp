@@ -0,0 +1,66 @@
+// Reference counting cost of intrusive_cow_ptr copies with biased_refcount, atomic_refcount and plain_refcount,
+// against std::shared_ptr. Copies are made and dropped on the owner thread, which biased_refcount optimizes for,
+// and on a second thread, where biased_refcount falls back to atomic counting.
+
+#include "biased_refcount.hpp"
+#include "intrusive_cow_ptr.hpp"
+#include "benchmark.hpp"
+
+#include <memory>
+#include <thread>
+
+namespace
+{
+    template <typename RefCountT>
+    struct item : sutil::shared_cloneable <item <RefCountT>, RefCountT>
+    {
+        int value = 0;
+
+        item* clone() const override
+        {
+            return new item(*this);
+        }
+    };
+
+    constexpr std::size_t copies = 16;
+
+    // makes and drops a few copies of p per iteration.
+    template <typename PtrT>
+    void copy_and_drop(char const* name, std::size_t n, PtrT const& p)
+    {
+        benchmark::run(name, n, [&](std::size_t) {
+            PtrT held[copies];
+            for (auto& h : held)
+                h = p;
+            benchmark::keep(held);
+        });
+    }
+
+    template <typename PtrT>
+    void on_other_thread(char const* name, std::size_t n, PtrT const& p)
+    {
+        std::thread t([&] { copy_and_drop(name, n, p); });
+        t.join();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t const n = benchmark::iterations(argc, argv, 1000000);
+
+    auto biased = sutil::make_intrusive_cow <item <sutil::biased_refcount> > ();
+    auto atomic = sutil::make_intrusive_cow <item <sutil::atomic_refcount> > ();
+    auto plain = sutil::make_intrusive_cow <item <sutil::plain_refcount> > ();
+    auto shared = std::make_shared <item <sutil::plain_refcount> > ();
+
+    std::printf("%zu copies made and dropped on the owner thread:\n", copies);
+    copy_and_drop("biased_refcount", n, biased);
+    copy_and_drop("atomic_refcount", n, atomic);
+    copy_and_drop("plain_refcount", n, plain);
+    copy_and_drop("std::shared_ptr", n, shared);
+
+    std::printf("%zu copies made and dropped on another thread:\n", copies);
+    on_other_thread("biased_refcount", n, biased);
+    on_other_thread("atomic_refcount", n, atomic);
+    on_other_thread("std::shared_ptr", n, shared);
+}
@@ -0,0 +1,42 @@
+#ifndef SIMPLE_UTIL_TEST_BENCHMARK_HPP_INCLUDED
+#define SIMPLE_UTIL_TEST_BENCHMARK_HPP_INCLUDED
+
+// A minimal timing harness for the micro-benchmarks.
+// Each benchmark takes the number of iterations as its first argument, ctest runs them with a small one as a smoke test.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+namespace benchmark
+{
+    inline std::size_t iterations(int argc, char** argv, std::size_t fallback)
+    {
+        return argc > 1 ? static_cast <std::size_t> (std::strtoull(argv[1], nullptr, 10)) : fallback;
+    }
+
+    // keeps the compiler from optimizing away the computation of value.
+    template <typename T>
+    inline void keep(T const& value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r"(&value) : "memory");
+#else
+        static_cast <void> (value);
+#endif
+    }
+
+    // runs f(i) for i in [0, n) and prints the time per call.
+    template <typename FunctionT>
+    void run(char const* name, std::size_t n, FunctionT f)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i != n; ++i)
+            f(i);
+        auto const elapsed = std::chrono::duration <double, std::nano> (std::chrono::steady_clock::now() - start);
+        std::printf("%-40s %10.2f ns\n", name, n ? elapsed.count() / static_cast <double> (n) : 0.0);
+    }
+}
+
+#endif // SIMPLE_UTIL_TEST_BENCHMARK_HPP_INCLUDED
@@ -0,0 +1,182 @@
+// Every object counted with biased_refcount is destroyed exactly once: when copies are dropped on other threads
+// and merged by the owner, when the owner thread exits first, and when references are dropped or objects are created
+// after the owner's thread_local state is gone. Run under ThreadSanitizer to check the ordering.
+
+#include "biased_refcount.hpp"
+#include "intrusive_cow_ptr.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    constexpr int max_objects = 20000;
+
+    std::atomic <int> destroyed[max_objects];
+    std::atomic <int> next_id{0};
+
+    struct item : sutil::shared_cloneable <item, sutil::biased_refcount>
+    {
+        int id;
+
+        item() : id(next_id.fetch_add(1, std::memory_order_relaxed)) {}
+        item(item const&) : item() {}
+
+        ~item() override
+        {
+            destroyed[id].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        item* clone() const override
+        {
+            return new item(*this);
+        }
+    };
+
+    using ptr = sutil::intrusive_cow_ptr <item>;
+
+    // the only vptr is cloneable's: owner, two counts, queue link and destroy function.
+    static_assert(!std::is_polymorphic <sutil::biased_refcount>::value, "no vptr of its own");
+    static_assert(sizeof(sutil::biased_refcount) == 5 * sizeof(void*), "five words");
+
+    void check_all_destroyed_once()
+    {
+        int const n = next_id.load();
+        for (int i = 0; i != n; ++i)
+            CHECK(destroyed[i].load() == 1);
+    }
+
+    // hands values over from one thread to another.
+    struct mailbox
+    {
+        std::mutex mutex;
+        std::vector <ptr> items;
+        bool closed = false;
+
+        void put(ptr p)
+        {
+            std::lock_guard <std::mutex> lock(mutex);
+            items.push_back(std::move(p));
+        }
+
+        bool take(std::vector <ptr>& out)
+        {
+            std::lock_guard <std::mutex> lock(mutex);
+            out.swap(items);
+            return !closed || !out.empty();
+        }
+
+        void close()
+        {
+            std::lock_guard <std::mutex> lock(mutex);
+            closed = true;
+        }
+    };
+
+    // the owner keeps some references and drops others, workers drop the copies they get.
+    void dropped_on_other_threads()
+    {
+        mailbox box;
+        std::vector <std::thread> workers;
+        for (int w = 0; w != 3; ++w)
+        {
+            workers.emplace_back([&box] {
+                std::vector <ptr> got;
+                while (box.take(got))
+                {
+                    for (auto& p : got)
+                    {
+                        ptr extra = p;
+                        CHECK(extra.use_count() >= 2);
+                    }
+                    got.clear();
+                    std::this_thread::yield();
+                }
+            });
+        }
+
+        std::vector <ptr> kept;
+        for (int i = 0; i != 5000; ++i)
+        {
+            ptr p = sutil::make_intrusive_cow <item> ();
+            box.put(p);
+            if (i % 3 == 0)
+                box.put(p);
+            if (i % 2 == 0)
+                kept.push_back(std::move(p));
+            if (i % 100 == 0)
+                sutil::biased_refcount::collect();
+        }
+        box.close();
+        for (auto& t : workers)
+            t.join();
+
+        sutil::biased_refcount::collect();
+        for (auto const& p : kept)
+            CHECK(p.use_count() == 1);
+        kept.clear();
+    }
+
+    // the owner thread exits while others still hold references.
+    void owner_exits_first()
+    {
+        std::vector <ptr> survivors;
+        std::thread owner([&survivors] {
+            for (int i = 0; i != 1000; ++i)
+            {
+                ptr p = sutil::make_intrusive_cow <item> ();
+                survivors.push_back(p);
+                if (i % 2 == 0)
+                    survivors.push_back(p);
+            }
+        });
+        owner.join();
+
+        std::thread other([&survivors] {
+            survivors.clear();
+        });
+        other.join();
+    }
+
+    // created before the thread's biased_refcount state, so destroyed after it.
+    struct late_holder
+    {
+        std::vector <ptr> held;
+
+        ~late_holder()
+        {
+            held.clear();
+            // created without an owner, counted atomically.
+            ptr late = sutil::make_intrusive_cow <item> ();
+            ptr copy = late;
+            CHECK(late.use_count() == 2);
+        }
+    };
+
+    void released_after_thread_state()
+    {
+        std::thread t([] {
+            thread_local late_holder holder;
+            for (int i = 0; i != 100; ++i)
+            {
+                ptr p = sutil::make_intrusive_cow <item> ();
+                holder.held.push_back(p);
+                holder.held.push_back(std::move(p));
+            }
+        });
+        t.join();
+    }
+}
+
+int main()
+{
+    dropped_on_other_threads();
+    owner_exits_first();
+    released_after_thread_state();
+    check_all_destroyed_once();
+}
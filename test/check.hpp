@@ -0,0 +1,11 @@
+#ifndef SIMPLE_UTIL_TEST_CHECK_HPP_INCLUDED
+#define SIMPLE_UTIL_TEST_CHECK_HPP_INCLUDED
+
+#include <cstdio>
+#include <cstdlib>
+
+// like assert, but independent of NDEBUG.
+#define CHECK(condition) \
+    ((condition) ? static_cast <void> (0) : (std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition), std::abort()))
+
+#endif // SIMPLE_UTIL_TEST_CHECK_HPP_INCLUDED
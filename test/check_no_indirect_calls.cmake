@@ -0,0 +1,53 @@
+# cmake -DOBJDUMP=<objdump> -DOBJECT=<object file> -DCLEAN=<symbols> -DDIRTY=<symbols> -P check_no_indirect_calls.cmake
+# Symbols are separated by commas.
+# Fails if a function in CLEAN contains an indirect call or jump, or if a function in DIRTY contains none.
+# Out of line parts of a function (like foo.cold) count as part of it.
+
+string(REPLACE "," ";" CLEAN "${CLEAN}")
+string(REPLACE "," ";" DIRTY "${DIRTY}")
+
+execute_process(COMMAND ${OBJDUMP} -d --no-show-raw-insn ${OBJECT}
+                OUTPUT_VARIABLE disassembly
+                RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${OBJDUMP} failed on ${OBJECT}")
+endif()
+
+# x86: call *%rax, jmp *0x8(%rax). AArch64: blr x1, br x1.
+set(indirect "(call|jmp)[a-z]*[ \t]+\\*|[ \t](blr|br)[ \t]")
+
+string(REPLACE ";" "\;" disassembly "${disassembly}")
+string(REPLACE "\n" ";" lines "${disassembly}")
+
+# name of the function each instruction belongs to -> number of indirect calls in it.
+set(current "")
+foreach (line IN LISTS lines)
+    if (line MATCHES "^[0-9a-f]+ <([^>.+]+)[^>]*>:")
+        set(current ${CMAKE_MATCH_1})
+        if (NOT DEFINED count_${current})
+            set(count_${current} 0)
+        endif()
+    elseif (current AND line MATCHES "${indirect}")
+        math(EXPR count_${current} "${count_${current}} + 1")
+    endif()
+endforeach()
+
+foreach (symbol IN LISTS CLEAN DIRTY)
+    if (NOT DEFINED count_${symbol})
+        message(FATAL_ERROR "${symbol} not found in ${OBJECT}")
+    endif()
+endforeach()
+
+foreach (symbol IN LISTS CLEAN)
+    if (count_${symbol} GREATER 0)
+        message(FATAL_ERROR "${symbol} contains ${count_${symbol}} indirect calls")
+    endif()
+    message(STATUS "${symbol}: no indirect calls")
+endforeach()
+
+foreach (symbol IN LISTS DIRTY)
+    if (count_${symbol} EQUAL 0)
+        message(FATAL_ERROR "${symbol} contains no indirect call, the check does not detect them")
+    endif()
+    message(STATUS "${symbol}: ${count_${symbol}} indirect calls")
+endforeach()
@@ -0,0 +1,57 @@
+// Compiled with optimization and disassembled by check_no_indirect_calls.cmake:
+// the copy_bytes and copy_construct paths of default_clone must not contain indirect calls.
+// sutil_codegen_member_clone is the control, its virtual clone() call has to show up as one.
+
+#include "value_ptr.hpp"
+
+#include <string>
+
+// not in an anonymous namespace, so that the compiler cannot see all overriders of shape::clone.
+namespace codegen
+{
+    struct pod
+    {
+        int a;
+        double b;
+        char c[16];
+    };
+
+    struct text
+    {
+        std::string s;
+        int n;
+    };
+
+    struct shape : sutil::cloneable <shape>
+    {
+    };
+
+    // trivially copyable, but not copy constructible.
+    struct move_only
+    {
+        move_only() = default;
+        move_only(move_only const&) = delete;
+        move_only(move_only&&) = default;
+        int a;
+    };
+
+    static_assert(sutil::detail::default_clone_strategy <pod>::value == sutil::clone_strategy::copy_bytes, "");
+    static_assert(sutil::detail::default_clone_strategy <text>::value == sutil::clone_strategy::copy_construct, "");
+    static_assert(sutil::detail::default_clone_strategy <shape>::value == sutil::clone_strategy::member_clone, "");
+    static_assert(sutil::detail::default_clone_strategy <move_only>::value != sutil::clone_strategy::copy_bytes, "");
+}
+
+extern "C" codegen::pod* sutil_codegen_copy_bytes(codegen::pod* p)
+{
+    return sutil::default_clone <codegen::pod> ()(p);
+}
+
+extern "C" codegen::text* sutil_codegen_copy_construct(codegen::text* p)
+{
+    return sutil::default_clone <codegen::text> ()(p);
+}
+
+extern "C" codegen::shape* sutil_codegen_member_clone(codegen::shape* p)
+{
+    return sutil::default_clone <codegen::shape> ()(p);
+}
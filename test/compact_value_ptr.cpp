@@ -0,0 +1,93 @@
+// Released pointers handed to a compact_value_ptr keep their policies only if they come from the same policy table.
+// Clones that come back null are not attached to anything.
+
+#include "compact_value_ptr.hpp"
+#include "check.hpp"
+
+#include <new>
+
+namespace
+{
+    struct item : sutil::policy_header
+    {
+        int value = 0;
+    };
+
+    // a stateful deleter, counts its calls per tag.
+    int deletes[3] = {};
+
+    struct tagged_delete
+    {
+        int tag;
+
+        void operator()(item* p) const
+        {
+            ++deletes[tag];
+            delete p;
+        }
+
+        bool operator==(tagged_delete const& other) const { return tag == other.tag; }
+    };
+
+    struct tagged_clone
+    {
+        item* operator()(item* p) const { return new item(*p); }
+        bool operator==(tagged_clone const&) const { return true; }
+    };
+
+    // fails every clone.
+    struct null_clone
+    {
+        item* operator()(item*) const { return nullptr; }
+    };
+
+    using tagged_ptr = sutil::compact_value_ptr <item, tagged_clone, tagged_delete>;
+    using plain_ptr = sutil::compact_value_ptr <item, sutil::copy_clone <item>, std::default_delete <item> >;
+
+    void same_table_keeps_policies()
+    {
+        tagged_ptr a(new item, tagged_delete{1}, tagged_clone());
+        tagged_ptr b;
+        b.reset(a.release());
+        tagged_ptr c(b.release());
+        CHECK(c.get_deleter().tag == 1);
+        c.reset();
+        CHECK(deletes[1] == 1 && deletes[0] == 0);
+    }
+
+    void other_table_gets_defaults()
+    {
+        tagged_ptr a(new item, tagged_delete{2}, tagged_clone());
+        plain_ptr b;
+        b.reset(a.release());
+        b.reset();
+        CHECK(deletes[2] == 0);
+
+        tagged_ptr c(new item, tagged_delete{2}, tagged_clone());
+        plain_ptr d(c.release());
+        d.reset();
+        CHECK(deletes[2] == 0);
+
+        // and back: the default policies of the tagged table, tag 0.
+        plain_ptr e(new item);
+        tagged_ptr f(e.release());
+        f.reset();
+        CHECK(deletes[0] == 1);
+    }
+
+    void null_clone_stays_empty()
+    {
+        sutil::compact_value_ptr <item, null_clone> a(new item);
+        sutil::compact_value_ptr <item, null_clone> b(a);
+        CHECK(a && !b);
+        b = a;
+        CHECK(!b);
+    }
+}
+
+int main()
+{
+    same_table_keeps_policies();
+    other_table_gets_defaults();
+    null_clone_stays_empty();
+}
@@ -0,0 +1,132 @@
+// Builds object trees of value_ptrs in constant expressions and checks their shape at compile time.
+// Every check is a static_assert, the program only has to compile.
+
+#include "value_ptr.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc)
+
+namespace
+{
+    // std::default_delete is constexpr from C++23 on only.
+    template <typename T>
+    struct constexpr_delete
+    {
+        constexpr constexpr_delete() noexcept = default;
+
+        template <typename U>
+        constexpr constexpr_delete(constexpr_delete <U> const&) noexcept {}
+
+        constexpr void operator()(T* p) const
+        {
+            delete p;
+        }
+    };
+
+    // a polymorphic tree, cloned through clone().
+    struct shape : sutil::cloneable <shape>
+    {
+        using ptr = sutil::value_ptr <shape, sutil::default_clone <shape>, constexpr_delete <shape> >;
+
+        constexpr virtual int area() const = 0;
+        constexpr virtual int count() const = 0;
+    };
+
+    struct square : shape
+    {
+        int side;
+
+        constexpr explicit square(int s) : side(s) {}
+        constexpr ~square() override {} // gcc needs user provided constexpr virtual destructors.
+        constexpr square* clone() const override { return new square(*this); }
+        constexpr int area() const override { return side * side; }
+        constexpr int count() const override { return 1; }
+    };
+
+    struct group : shape
+    {
+        ptr first;
+        ptr second;
+
+        constexpr group(ptr a, ptr b) : first(std::move(a)), second(std::move(b)) {}
+        constexpr group(group const&) = default;
+        constexpr ~group() override {}
+        constexpr group* clone() const override { return new group(*this); }
+        constexpr int area() const override { return (first ? first->area() : 0) + (second ? second->area() : 0); }
+        constexpr int count() const override { return 1 + (first ? first->count() : 0) + (second ? second->count() : 0); }
+    };
+
+    constexpr shape::ptr default_scene()
+    {
+        return sutil::make_value <group, sutil::default_clone <shape>, constexpr_delete <shape> > (
+            shape::ptr(new square(2)),
+            sutil::make_value <group, sutil::default_clone <shape>, constexpr_delete <shape> > (
+                shape::ptr(new square(3)),
+                shape::ptr()));
+    }
+
+    static_assert(default_scene()->count() == 4, "");
+    static_assert(default_scene()->area() == 13, "");
+
+    // copies are deep, modifying one leaves the other alone.
+    constexpr bool copies_are_deep()
+    {
+        shape::ptr a = default_scene();
+        shape::ptr b = a;
+        static_cast <square*> (static_cast <group*> (b.get())->first.get())->side = 5;
+        return a->area() == 13 && b->area() == 34 && a.get() != b.get();
+    }
+    static_assert(copies_are_deep(), "");
+
+    constexpr bool assign_reset_release()
+    {
+        shape::ptr a = default_scene();
+        shape::ptr b;
+        b = a;
+        b = std::move(a);
+        bool const moved = !a && b->count() == 4;
+        b.reset(new square(1));
+        shape* raw = b.release();
+        int const area = raw->area();
+        delete raw;
+        return moved && !b && area == 1;
+    }
+    static_assert(assign_reset_release(), "");
+
+    // a non-polymorphic tree, cloned by copy construction.
+    struct node
+    {
+        int value;
+        sutil::value_ptr <node, sutil::default_clone <node>, constexpr_delete <node> > left;
+        sutil::value_ptr <node, sutil::default_clone <node>, constexpr_delete <node> > right;
+
+        constexpr int sum() const
+        {
+            return value + (left ? left->sum() : 0) + (right ? right->sum() : 0);
+        }
+
+        constexpr int depth() const
+        {
+            int const l = left ? left->depth() : 0;
+            int const r = right ? right->depth() : 0;
+            return 1 + (l > r ? l : r);
+        }
+    };
+
+    static_assert(sutil::detail::default_clone_strategy <node>::value == sutil::clone_strategy::copy_construct, "");
+
+    constexpr bool node_tree()
+    {
+        using ptr = sutil::value_ptr <node, sutil::default_clone <node>, constexpr_delete <node> >;
+        ptr root(new node{1, ptr(new node{2, ptr(), ptr()}), ptr(new node{3, ptr(new node{4, ptr(), ptr()}), ptr()})});
+        ptr copy = root;
+        copy->right->left->value = 40;
+        return root->sum() == 10 && copy->sum() == 46 && root->depth() == 3;
+    }
+    static_assert(node_tree(), "");
+}
+
+#endif
+
+int main()
+{
+}
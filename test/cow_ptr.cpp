@@ -0,0 +1,69 @@
+// A reader thread reads through a copy and drops it, the writer waits until the pointee is unshared
+// and then writes in place, without any other synchronization. Run under ThreadSanitizer to check the ordering.
+// Also covers borrowing and resetting, including to the pointer already held.
+
+#include "cow_ptr.hpp"
+#include "check.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using ptr = sutil::cow_ptr <std::vector <int> >;
+
+    void write_after_readers_drop()
+    {
+        for (int round = 0; round != 100; ++round)
+        {
+            ptr value = sutil::make_cow <std::vector <int> > (64, round);
+            long sum = 0;
+            std::thread reader([copy = value, &sum]() mutable {
+                for (int x : *copy)
+                    sum += x;
+                copy.reset();
+            });
+            while (value.is_shared())
+                std::this_thread::yield();
+            int* data = value.modify()->data();
+            data[0] = -1;
+            reader.join();
+            CHECK(sum == 64L * round && value.use_count() == 1);
+        }
+    }
+
+    void borrow_and_reset()
+    {
+        static std::vector <int> const prototype(3, 7);
+        ptr a = ptr::borrow(prototype);
+        CHECK(a.is_shared() && a.use_count() == 0);
+        ptr b = a;
+        b.modify()->push_back(8);
+        CHECK(prototype.size() == 3 && b->size() == 4 && b.use_count() == 1);
+        a = b;
+        CHECK(a.use_count() == 2 && a.get() == b.get());
+        a.reset(new std::vector <int> (1));
+        CHECK(a.use_count() == 1 && b.use_count() == 1);
+        b = std::move(a);
+        CHECK(!a && b->size() == 1);
+    }
+
+    void reset_to_held()
+    {
+        std::vector <int>* raw = new std::vector <int> (2, 5);
+        ptr a(raw);
+        a.reset(raw);
+        CHECK(a.get() == raw && a.use_count() == 1 && (*a)[1] == 5);
+
+        ptr b = a;
+        b.reset(raw);
+        CHECK(a.use_count() == 2 && b->size() == 2);
+    }
+}
+
+int main()
+{
+    write_after_readers_drop();
+    borrow_and_reset();
+    reset_to_held();
+}
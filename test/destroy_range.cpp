@@ -0,0 +1,68 @@
+// destroy_range over mixed dynamic types, built without RTTI.
+// Classes with their own operator new and delete must get them back.
+
+#include "destroy_range.hpp"
+#include "check.hpp"
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace
+{
+    int alive = 0;
+    int class_deletes = 0;
+
+    struct shape : sutil::cloneable <shape>
+    {
+        shape() { ++alive; }
+        shape(shape const&) { ++alive; }
+        virtual ~shape() { --alive; }
+    };
+
+    struct circle : shape
+    {
+        shape* clone() const override { return new circle(*this); }
+    };
+
+    struct square : shape
+    {
+        double side = 1;
+
+        shape* clone() const override { return new square(*this); }
+
+        static void* operator new(std::size_t size) { return ::operator new(size); }
+        static void operator delete(void* p) { ++class_deletes; ::operator delete(p); }
+    };
+
+    struct plain
+    {
+        plain() { ++alive; }
+        ~plain() { --alive; }
+    };
+}
+
+int main()
+{
+    std::vector <sutil::value_ptr <shape> > shapes;
+    for (int i = 0; i != 10; ++i)
+    {
+        if (i % 2)
+            shapes.emplace_back(new circle);
+        else
+            shapes.emplace_back(new square);
+    }
+    shapes.emplace_back();
+    CHECK(alive == 10);
+    sutil::destroy_range(shapes.begin(), shapes.end());
+    CHECK(alive == 0);
+    CHECK(class_deletes == 5);
+    for (auto const& p : shapes)
+        CHECK(!p);
+
+    std::vector <sutil::value_ptr <plain> > plains;
+    for (int i = 0; i != 3; ++i)
+        plains.emplace_back(new plain);
+    sutil::clear_values(plains);
+    CHECK(alive == 0 && plains.empty());
+}
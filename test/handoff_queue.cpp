@@ -0,0 +1,55 @@
+// A producer and a consumer hand values over, every value must arrive once, in order.
+// size() may lag behind, but only to the safe side for the calling thread: while the producer sees room,
+// a push must succeed, and while the consumer sees values, a pop must succeed.
+
+#include "handoff_queue.hpp"
+#include "check.hpp"
+
+#include <thread>
+
+namespace
+{
+    using queue = sutil::spsc_value_queue <int, sutil::copy_clone <int> >;
+
+    constexpr int count = 20000;
+}
+
+int main()
+{
+    queue q(64);
+
+    std::thread producer([&] {
+        for (int i = 0; i != count; ++i)
+        {
+            queue::value_type v(new int(i));
+            for (;;)
+            {
+                bool const room = q.size() < q.capacity();
+                if (q.try_push(std::move(v)))
+                    break;
+                CHECK(!room);
+                CHECK(v && *v == i);
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected = 0;
+    queue::value_type v;
+    while (expected != count)
+    {
+        bool const filled = !q.empty();
+        if (q.try_pop(v))
+        {
+            CHECK(*v == expected);
+            ++expected;
+        }
+        else
+        {
+            CHECK(!filled);
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(q.empty());
+}
@@ -0,0 +1,147 @@
+// history: undo and redo, committing over revisions that could be redone, editors that throw,
+// and pruning to the budget, oldest first, then redoable ones, never the current revision.
+// Revisions of a document with cow_ptr children share what an edit did not touch.
+
+#include "history.hpp"
+#include "check.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    struct document
+    {
+        int title;
+        std::vector <sutil::cow_ptr <int> > paragraphs;
+    };
+
+    using doc_ptr = sutil::cow_ptr <document>;
+    using history = sutil::history <document>;
+
+    doc_ptr make_document()
+    {
+        doc_ptr doc = sutil::make_cow <document> ();
+        doc.modify()->title = 0;
+        for (int i = 0; i != 3; ++i)
+            doc.modify()->paragraphs.push_back(sutil::make_cow <int> (i));
+        return doc;
+    }
+
+    void set_title(history& h, int title, std::size_t cost = 1)
+    {
+        h.edit([title](doc_ptr& doc) { doc.modify()->title = title; }, cost);
+    }
+
+    void undo_redo()
+    {
+        history h(make_document());
+        CHECK(!h.can_undo() && !h.can_redo() && !h.undo() && !h.redo());
+
+        set_title(h, 1);
+        set_title(h, 2);
+        CHECK(h.size() == 3 && h.current()->title == 2);
+
+        CHECK(h.undo() && h.current()->title == 1);
+        CHECK(h.undo() && h.current()->title == 0);
+        CHECK(!h.undo());
+        CHECK(h.redo() && h.current()->title == 1);
+        CHECK(h.can_redo());
+
+        // committing drops what could have been redone.
+        set_title(h, 3);
+        CHECK(!h.can_redo() && h.size() == 3);
+        CHECK(h.undo() && h.current()->title == 1);
+        CHECK(h.undo() && h.current()->title == 0);
+    }
+
+    void failed_edit()
+    {
+        history h(make_document());
+        set_title(h, 1);
+        bool thrown = false;
+        try
+        {
+            h.edit([](doc_ptr& doc) {
+                doc.modify()->title = 2;
+                throw std::runtime_error("rejected");
+            });
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(h.size() == 2 && h.current()->title == 1 && h.total_cost() == 1);
+    }
+
+    void shared_revisions()
+    {
+        history h(make_document());
+        h.edit([](doc_ptr& doc) { *doc.modify()->paragraphs[1].modify() = 10; });
+        doc_ptr const after = h.current();
+        h.undo();
+        doc_ptr const before = h.current();
+        CHECK(*before->paragraphs[1] == 1 && *after->paragraphs[1] == 10);
+        CHECK(before->paragraphs[0].get() == after->paragraphs[0].get());
+        CHECK(before->paragraphs[2].get() == after->paragraphs[2].get());
+    }
+
+    void prune_oldest()
+    {
+        history h(make_document(), 3);
+        for (int i = 1; i <= 5; ++i)
+            set_title(h, i);
+        // the first kept revision costs nothing, it has nothing to undo to.
+        CHECK(h.size() == 4 && h.total_cost() == 3);
+        CHECK(h.undo() && h.undo() && h.undo() && !h.undo());
+        CHECK(h.current()->title == 2);
+
+        // costs other than one.
+        history weighted(make_document(), 5);
+        set_title(weighted, 1, 2);
+        set_title(weighted, 2, 2);
+        CHECK(weighted.size() == 3 && weighted.total_cost() == 4);
+        set_title(weighted, 3, 2);
+        CHECK(weighted.size() == 3 && weighted.total_cost() == 4);
+        CHECK(weighted.undo() && weighted.undo() && weighted.current()->title == 1);
+    }
+
+    void prune_redoable()
+    {
+        history h(make_document());
+        for (int i = 1; i <= 4; ++i)
+            set_title(h, i);
+        CHECK(h.undo() && h.undo() && h.undo() && h.undo());
+        CHECK(h.current()->title == 0 && h.total_cost() == 4);
+
+        // nothing older to drop, so the revisions furthest ahead go.
+        h.set_budget(2);
+        CHECK(h.size() == 3 && h.total_cost() == 2 && h.current()->title == 0);
+        CHECK(h.redo() && h.redo() && !h.redo());
+        CHECK(h.current()->title == 2);
+    }
+
+    void keep_current()
+    {
+        history h(make_document(), 2);
+        set_title(h, 1);
+        set_title(h, 2, 10);
+        CHECK(h.size() == 1 && h.total_cost() == 0);
+        CHECK(h.current()->title == 2 && !h.can_undo());
+
+        h.set_budget(0);
+        set_title(h, 3);
+        CHECK(h.size() == 1 && h.current()->title == 3);
+    }
+}
+
+int main()
+{
+    undo_redo();
+    failed_edit();
+    shared_revisions();
+    prune_oldest();
+    prune_redoable();
+    keep_current();
+}
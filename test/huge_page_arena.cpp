@@ -0,0 +1,55 @@
+// Built without exceptions: allocation goes through the error_code overloads.
+
+#include "huge_page_arena.hpp"
+#include "check.hpp"
+
+#include <system_error>
+
+namespace
+{
+    struct shape : sutil::placement_cloneable <shape>
+    {
+        virtual ~shape() = default;
+        virtual int sides() const = 0;
+    };
+
+    struct triangle : sutil::cloneable_impl <triangle, shape>
+    {
+        int sides() const override { return 3; }
+    };
+
+    struct point
+    {
+        double x, y;
+    };
+}
+
+int main()
+{
+    std::size_t const page = sutil::huge_page_arena::huge_page_size();
+    CHECK(page != 0 && (page & (page - 1)) == 0);
+
+    sutil::huge_page_arena arena(1);
+    CHECK(arena.bytes_reserved() == 0);
+
+    auto p = sutil::make_arena_value <point> (arena, point{1, 2});
+    std::error_code ec;
+    auto q = p.try_clone(ec);
+    CHECK(!ec && q && q->y == 2 && q.get() != p.get());
+    CHECK(arena.bytes_reserved() == page);
+
+    sutil::arena_value_ptr <shape> s(sutil::make_arena_value <triangle> (arena).release(),
+                                     sutil::arena_delete <shape> (), sutil::arena_clone <shape> (&arena));
+    auto t = s.try_clone(ec);
+    CHECK(!ec && t->sides() == 3);
+
+    // bigger than a region: gets a region of its own.
+    void* big = arena.allocate(3 * page, 64, ec);
+    CHECK(!ec && big && reinterpret_cast <std::uintptr_t> (big) % 64 == 0);
+    CHECK(arena.bytes_reserved() >= 4 * page);
+
+    // copying an empty arena_value_ptr needs no arena.
+    sutil::arena_value_ptr <point> empty;
+    auto empty_copy = empty;
+    CHECK(!empty_copy);
+}
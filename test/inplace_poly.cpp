@@ -0,0 +1,58 @@
+#include "inplace_poly.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <type_traits>
+
+namespace
+{
+    struct shape
+    {
+        virtual ~shape() = default;
+        virtual int sides() const = 0;
+    };
+
+    struct square : shape
+    {
+        int sides() const override { return 4; }
+    };
+
+    struct big_square : square
+    {
+        char padding[128];
+    };
+
+    struct animal
+    {
+        virtual ~animal() = default;
+    };
+
+    struct cat : animal {};
+
+    using small_shape = sutil::inplace_poly <shape, 32>;
+
+    // overload resolution must only see the slot the argument can be stored in.
+    int pick(small_shape const&) { return 1; }
+    int pick(sutil::inplace_poly <animal, 32> const&) { return 2; }
+}
+
+// the converting constructor is constrained on the base and the size.
+static_assert(std::is_convertible <square, small_shape>::value, "derived");
+static_assert(!std::is_convertible <cat, small_shape>::value, "unrelated");
+static_assert(!std::is_convertible <int, small_shape>::value, "not a class");
+static_assert(!std::is_convertible <big_square, small_shape>::value, "too big");
+static_assert(!std::is_assignable <small_shape&, std::string>::value, "unrelated");
+static_assert(std::is_convertible <big_square, sutil::inplace_poly <shape, sizeof(big_square)> >::value, "fits");
+
+int main()
+{
+    small_shape s = square();
+    CHECK(s && s->sides() == 4);
+
+    CHECK(pick(square()) == 1);
+    CHECK(pick(cat()) == 2);
+
+    small_shape copy = s;
+    s = nullptr;
+    CHECK(!s && copy->sides() == 4);
+}
@@ -0,0 +1,105 @@
+// intrusive_cow_ptr over shared_cloneable objects, with atomic_refcount and plain_refcount:
+// copies share the pointee and count it, modify() clones only shared pointees, the last owner deletes.
+// With atomic_refcount, threads also copy and drop a shared pointee concurrently.
+
+#include "intrusive_cow_ptr.hpp"
+#include "check.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    int alive = 0;
+    int clones = 0;
+
+    template <typename RefCountT>
+    struct document : sutil::shared_cloneable <document <RefCountT>, RefCountT>
+    {
+        int value;
+
+        explicit document(int v) : value(v) { ++alive; }
+        document(document const& other) : sutil::shared_cloneable <document, RefCountT> (other), value(other.value) { ++alive; }
+        ~document() { --alive; }
+
+        document* clone() const override
+        {
+            ++clones;
+            return new document(*this);
+        }
+    };
+
+    template <typename RefCountT>
+    void share_and_clone()
+    {
+        using ptr = sutil::intrusive_cow_ptr <document <RefCountT> >;
+        static_assert(sizeof(ptr) == sizeof(void*), "stateless policies take no space");
+
+        alive = 0;
+        clones = 0;
+        {
+            ptr a = sutil::make_intrusive_cow <document <RefCountT> > (1);
+            CHECK(a.use_count() == 1 && !a.is_shared());
+
+            ptr b = a;
+            CHECK(b.get() == a.get() && a.use_count() == 2 && b.use_count() == 2);
+            CHECK(a.is_shared() && b.is_shared() && alive == 1);
+
+            // writing to a shared pointee clones it, the clone starts with a count of its own.
+            b.modify()->value = 2;
+            CHECK(clones == 1 && alive == 2);
+            CHECK(b.get() != a.get() && a->value == 1 && b->value == 2);
+            CHECK(a.use_count() == 1 && b.use_count() == 1);
+
+            // not shared, written in place.
+            auto const before = b.get();
+            b.modify()->value = 3;
+            CHECK(clones == 1 && b.get() == before);
+
+            ptr c(std::move(a));
+            CHECK(!a && a.use_count() == 0 && c.use_count() == 1);
+
+            a = c;
+            CHECK(c.use_count() == 2);
+            a = a;
+            CHECK(c.use_count() == 2);
+            a = std::move(b);
+            CHECK(!b && c.use_count() == 1 && a->value == 3 && alive == 2);
+
+            c.reset();
+            CHECK(alive == 1 && !c);
+        }
+        CHECK(alive == 0);
+    }
+
+    void concurrent_sharing()
+    {
+        using ptr = sutil::intrusive_cow_ptr <document <sutil::atomic_refcount> >;
+        alive = 0;
+        {
+            ptr shared = sutil::make_intrusive_cow <document <sutil::atomic_refcount> > (7);
+            std::vector <std::thread> threads;
+            for (int t = 0; t != 4; ++t)
+            {
+                threads.emplace_back([shared] {
+                    for (int i = 0; i != 10000; ++i)
+                    {
+                        ptr copy = shared;
+                        CHECK(copy->value == 7 && copy.use_count() >= 2);
+                    }
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+            CHECK(shared.use_count() == 1 && alive == 1);
+        }
+        CHECK(alive == 0);
+    }
+}
+
+int main()
+{
+    share_and_clone <sutil::atomic_refcount> ();
+    share_and_clone <sutil::plain_refcount> ();
+    concurrent_sharing();
+}
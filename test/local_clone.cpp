@@ -0,0 +1,92 @@
+// local_clone: copies that fit are placed into the holder's buffer, larger or over-aligned ones on the heap.
+// Either way the copy is independent of the original and destroyed exactly once with the holder.
+// Built as C++17 for local_clone(), which needs guaranteed copy elision.
+
+#include "local_clone.hpp"
+#include "check.hpp"
+
+#include <cstdint>
+
+namespace
+{
+    int alive = 0;
+
+    struct shape : sutil::placement_cloneable <shape>
+    {
+        int id = 0;
+
+        shape() { ++alive; }
+        shape(shape const& other) : sutil::placement_cloneable <shape> (other), id(other.id) { ++alive; }
+        virtual ~shape() { --alive; }
+    };
+
+    template <std::size_t Size>
+    struct blob : sutil::cloneable_impl <blob <Size>, shape>
+    {
+        unsigned char bytes[Size] = {};
+    };
+
+    struct alignas(2 * alignof(std::max_align_t)) aligned : sutil::cloneable_impl <aligned, shape>
+    {
+    };
+
+    template <typename HolderT>
+    bool inside(HolderT const& holder)
+    {
+        auto const p = reinterpret_cast <std::uintptr_t> (holder.get());
+        auto const begin = reinterpret_cast <std::uintptr_t> (&holder);
+        return p >= begin && p < begin + sizeof(HolderT);
+    }
+
+    void placement()
+    {
+        blob <16> small;
+        small.id = 1;
+        {
+            sutil::local_clone_holder <shape, 64> copy(small);
+            CHECK(copy.is_local() && inside(copy));
+            CHECK(copy->id == 1 && dynamic_cast <blob <16>*> (copy.get()));
+            CHECK(alive == 2);
+
+            copy->id = 2;
+            CHECK(small.id == 1);
+        }
+        CHECK(alive == 1);
+
+        blob <256> large;
+        {
+            sutil::local_clone_holder <shape, 64> copy(large);
+            CHECK(!copy.is_local() && !inside(copy));
+            CHECK(dynamic_cast <blob <256>*> (copy.get()) && alive == 3);
+        }
+        CHECK(alive == 2);
+
+        aligned over;
+        {
+            sutil::local_clone_holder <shape, 1024> copy(over);
+            CHECK(!copy.is_local());
+            CHECK(reinterpret_cast <std::uintptr_t> (copy.get()) % alignof(aligned) == 0);
+        }
+        CHECK(alive == 3);
+    }
+
+    void factory()
+    {
+        blob <8> original;
+        original.id = 5;
+        {
+            auto copy = sutil::local_clone <32> (static_cast <shape const&> (original));
+            static_assert(decltype(copy)::buffer_size == 32, "the buffer size is the template argument");
+            CHECK(copy.is_local() && copy->id == 5 && alive == 2);
+        }
+        CHECK(alive == 1);
+    }
+}
+
+int main()
+{
+    placement();
+    CHECK(alive == 0);
+    factory();
+    CHECK(alive == 0);
+}
@@ -0,0 +1,149 @@
+// mpmc_value_queue: full and empty edges and partial batches on one thread, then producers and consumers
+// pushing and popping batches concurrently. Every value must be delivered exactly once, each consumer must see
+// the values of a producer in the order they were pushed, and values left in the queue are destroyed with it.
+
+#include "handoff_queue.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+namespace
+{
+    std::atomic <int> alive(0);
+
+    struct item
+    {
+        int producer;
+        int index;
+
+        item(int producer, int index) : producer(producer), index(index) { ++alive; }
+        item(item const& other) : producer(other.producer), index(other.index) { ++alive; }
+        ~item() { --alive; }
+    };
+
+    using queue = sutil::mpmc_value_queue <item, sutil::copy_clone <item> >;
+    using value = queue::value_type;
+
+    void edges()
+    {
+        {
+            queue q(5);
+            CHECK(q.capacity() == 8);
+
+            value out[8];
+            CHECK(q.try_pop_batch(out, 8) == 0);
+            CHECK(!q.try_pop(out[0]));
+
+            value in[10];
+            for (int i = 0; i != 10; ++i)
+                in[i].reset(new item(0, i));
+
+            // only as many as fit are pushed, the rest is left alone.
+            CHECK(q.try_push_batch(in, 10) == 8);
+            for (int i = 0; i != 8; ++i)
+                CHECK(!in[i]);
+            CHECK(in[8]->index == 8 && in[9]->index == 9);
+            CHECK(!q.try_push(std::move(in[8])));
+            CHECK(in[8] && in[8]->index == 8);
+            CHECK(q.try_push_batch(in + 8, 2) == 0);
+
+            // partial pops, then the freed slots take the rest across the wrap around.
+            CHECK(q.try_pop_batch(out, 3) == 3);
+            CHECK(out[0]->index == 0 && out[2]->index == 2);
+            CHECK(q.try_push_batch(in + 8, 2) == 2);
+            CHECK(!in[8] && !in[9]);
+
+            CHECK(q.try_pop_batch(out, 8) == 7);
+            for (int i = 0; i != 7; ++i)
+                CHECK(out[i]->index == i + 3);
+            CHECK(!q.try_pop(out[7]));
+            CHECK(alive == 7);
+
+            // left in the queue for its destructor.
+            CHECK(q.try_push(value(new item(0, 10))));
+            CHECK(q.try_push(value(new item(0, 11))));
+        }
+        CHECK(alive == 0);
+    }
+
+    constexpr int producers = 4;
+    constexpr int consumers = 4;
+    constexpr int per_producer = 20000;
+
+    void concurrent()
+    {
+        queue q(64);
+        std::vector <std::atomic <int> > delivered(producers * per_producer);
+        for (auto& d : delivered)
+            d.store(0, std::memory_order_relaxed);
+        std::atomic <int> popped(0);
+
+        std::vector <std::thread> threads;
+        for (int p = 0; p != producers; ++p)
+        {
+            threads.emplace_back([&q, p] {
+                value batch[7];
+                int next = 0;
+                std::size_t const size = 1 + p * 2;
+                while (next != per_producer)
+                {
+                    std::size_t n = 0;
+                    for (; n != size && next + static_cast <int> (n) != per_producer; ++n)
+                        batch[n].reset(new item(p, next + static_cast <int> (n)));
+                    std::size_t pushed = 0;
+                    while (pushed != n)
+                    {
+                        std::size_t const count = q.try_push_batch(batch + pushed, n - pushed);
+                        if (count == 0)
+                            std::this_thread::yield();
+                        pushed += count;
+                    }
+                    next += static_cast <int> (n);
+                }
+            });
+        }
+        for (int c = 0; c != consumers; ++c)
+        {
+            threads.emplace_back([&q, &delivered, &popped, c] {
+                std::vector <int> last(producers, -1);
+                value batch[5];
+                std::size_t const size = 1 + c;
+                while (popped.load(std::memory_order_relaxed) != producers * per_producer)
+                {
+                    std::size_t const n = q.try_pop_batch(batch, size);
+                    if (n == 0)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    for (std::size_t i = 0; i != n; ++i)
+                    {
+                        item const& v = *batch[i];
+                        CHECK(v.index > last[v.producer]);
+                        last[v.producer] = v.index;
+                        delivered[v.producer * per_producer + v.index].fetch_add(1, std::memory_order_relaxed);
+                        batch[i].reset();
+                    }
+                    popped.fetch_add(static_cast <int> (n), std::memory_order_relaxed);
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        for (auto& d : delivered)
+            CHECK(d.load(std::memory_order_relaxed) == 1);
+        value rest;
+        CHECK(!q.try_pop(rest));
+        CHECK(alive == 0);
+    }
+}
+
+int main()
+{
+    edges();
+    concurrent();
+}
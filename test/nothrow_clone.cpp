@@ -0,0 +1,150 @@
+// nothrow_clone with value_ptr::try_clone and try_assign: errors on allocation failure, the target left alone,
+// and std::terminate from the single argument overload, which has no way to report it.
+// Allocation failure is simulated by a replaced nothrow operator new. The last case terminates on purpose,
+// the terminate handler turns that into success.
+
+#include "value_ptr.hpp"
+#include "check.hpp"
+
+#include <exception>
+#include <new>
+#include <system_error>
+#include <cstdlib>
+#include <cstddef>
+
+namespace
+{
+    bool fail_allocation = false;
+    bool terminate_expected = false;
+
+    void* allocate(std::size_t size) noexcept
+    {
+        if (fail_allocation)
+            return nullptr;
+        return std::malloc(size ? size : 1);
+    }
+}
+
+// through malloc, so that the matching operator delete can tell nothing apart from the default one.
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    int alive = 0;
+
+    struct point
+    {
+        int x;
+        int y;
+
+        point(int x, int y) : x(x), y(y) { ++alive; }
+        point(point const& other) : x(other.x), y(other.y) { ++alive; }
+        ~point() { --alive; }
+    };
+
+    using ptr = sutil::value_ptr <point, sutil::nothrow_clone <point> >;
+
+    void try_clone_with_error_code()
+    {
+        ptr original(new point(1, 2));
+        std::error_code ec = std::make_error_code(std::errc::invalid_argument);
+        ptr copy = original.try_clone(ec);
+        CHECK(!ec);
+        CHECK(copy && copy.get() != original.get() && copy->x == 1 && copy->y == 2);
+
+        fail_allocation = true;
+        ptr failed = original.try_clone(ec);
+        fail_allocation = false;
+        CHECK(ec == std::errc::not_enough_memory);
+        CHECK(!failed);
+
+        ptr empty;
+        ptr empty_copy = empty.try_clone(ec);
+        CHECK(!ec && !empty_copy);
+        CHECK(alive == 2);
+    }
+
+    void try_clone_expected()
+    {
+#if defined(__cpp_lib_expected)
+        ptr original(new point(3, 4));
+        auto copy = original.try_clone();
+        CHECK(copy.has_value() && (*copy)->x == 3);
+
+        fail_allocation = true;
+        auto failed = original.try_clone();
+        fail_allocation = false;
+        CHECK(!failed.has_value() && failed.error() == std::errc::not_enough_memory);
+        CHECK(alive == 2);
+#endif
+    }
+
+    void try_assign()
+    {
+        ptr target(new point(5, 6));
+        ptr source(new point(7, 8));
+
+        fail_allocation = true;
+        std::error_code ec = target.try_assign(source);
+        fail_allocation = false;
+        CHECK(ec == std::errc::not_enough_memory);
+        CHECK(target->x == 5 && target->y == 6);
+        CHECK(alive == 2);
+
+        ec = target.try_assign(source);
+        CHECK(!ec);
+        CHECK(target->x == 7 && target.get() != source.get());
+        CHECK(alive == 2);
+
+        ec = target.try_assign(ptr());
+        CHECK(!ec && !target);
+        CHECK(alive == 1);
+    }
+
+    void copy_terminates()
+    {
+        ptr original(new point(9, 10));
+        std::set_terminate([] {
+            std::_Exit(terminate_expected ? EXIT_SUCCESS : EXIT_FAILURE);
+        });
+        terminate_expected = true;
+        fail_allocation = true;
+        ptr copy(original);
+        std::_Exit(EXIT_FAILURE); // the copy must not come back empty.
+    }
+}
+
+int main()
+{
+    try_clone_with_error_code();
+    try_clone_expected();
+    CHECK(alive == 0);
+    try_assign();
+    CHECK(alive == 0);
+    copy_terminates();
+}
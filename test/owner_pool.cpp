@@ -0,0 +1,51 @@
+// Values made on short-lived producer threads and destroyed on the main thread.
+// Every producer's pool is abandoned when it exits and adopted by a later one, all at once or a few at a time.
+
+#include "owner_pool.hpp"
+#include "check.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct message
+    {
+        int payload[6];
+    };
+
+    using ptr = sutil::owner_value_ptr <message>;
+
+    void produce(std::vector <ptr>& out, int n)
+    {
+        for (int i = 0; i != n; ++i)
+        {
+            out.push_back(sutil::make_owner_value <message> ());
+            out.back()->payload[0] = i;
+        }
+        // a copy made here and dropped on the main thread, too.
+        out.push_back(out.front());
+    }
+
+    void round(int threads)
+    {
+        std::vector <std::vector <ptr> > outputs(threads);
+        std::vector <std::thread> producers;
+        for (int t = 0; t != threads; ++t)
+            producers.emplace_back(produce, std::ref(outputs[t]), 300);
+        for (auto& t : producers)
+            t.join();
+        for (auto const& out : outputs)
+            CHECK(out.size() == 301 && out.back()->payload[0] == 0 && out[299]->payload[0] == 299);
+        // remote frees, to pools whose threads are gone.
+        outputs.clear();
+    }
+}
+
+int main()
+{
+    round(8);
+    round(1);
+    round(16);
+    round(2);
+}
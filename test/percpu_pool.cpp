@@ -0,0 +1,116 @@
+// percpu_pool: blocks are distinct and aligned, survive being freed on other threads and are recycled,
+// and percpu_value_ptrs clone into the pool. Built as C++11, where the per-CPU caches are aligned by hand;
+// the undefined behavior sanitizer checks their alignment.
+
+#include "percpu_pool.hpp"
+#include "check.hpp"
+
+#include <set>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace
+{
+    struct message
+    {
+        int id;
+        int payload[5];
+
+        explicit message(int id) : id(id)
+        {
+            for (int& x : payload)
+                x = id;
+        }
+
+        bool intact() const
+        {
+            for (int x : payload)
+            {
+                if (x != id)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    using ptr = sutil::percpu_value_ptr <message>;
+    using pool = sutil::percpu_pool_for <message>;
+
+    void distinct_blocks()
+    {
+        // more than a chunk, so the depot is carved more than once.
+        std::size_t const n = 3 * pool::chunk_blocks;
+        std::vector <void*> blocks;
+        std::set <void*> unique;
+        for (std::size_t i = 0; i != n; ++i)
+        {
+            void* p = pool::instance().allocate();
+            CHECK(reinterpret_cast <std::uintptr_t> (p) % pool::block_alignment == 0);
+            blocks.push_back(p);
+            unique.insert(p);
+        }
+        CHECK(unique.size() == n);
+        for (void* p : blocks)
+            pool::instance().deallocate(p);
+
+        // recycled through the caches and the depot, still handed out once each.
+        std::set <void*> again;
+        for (std::size_t i = 0; i != n; ++i)
+            again.insert(pool::instance().allocate());
+        CHECK(again.size() == n);
+        for (void* p : again)
+            pool::instance().deallocate(p);
+    }
+
+    void freed_on_other_threads()
+    {
+        int const threads = 8;
+        int const per_thread = 2000;
+        std::vector <std::vector <ptr> > made(threads);
+        std::vector <std::thread> workers;
+        for (int t = 0; t != threads; ++t)
+        {
+            workers.emplace_back([&made, t, per_thread] {
+                for (int i = 0; i != per_thread; ++i)
+                    made[t].push_back(sutil::make_percpu_value <message> (t * per_thread + i));
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+        workers.clear();
+
+        // every thread drops the values of its neighbor, while making new ones.
+        for (int t = 0; t != threads; ++t)
+        {
+            workers.emplace_back([&made, t, threads, per_thread] {
+                std::vector <ptr>& theirs = made[(t + 1) % threads];
+                for (int i = 0; i != per_thread; ++i)
+                {
+                    CHECK(theirs[i]->intact() && theirs[i]->id == ((t + 1) % threads) * per_thread + i);
+                    ptr fresh = sutil::make_percpu_value <message> (-i);
+                    theirs[i].reset();
+                    CHECK(fresh->intact());
+                }
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+    }
+
+    void clones()
+    {
+        ptr original = sutil::make_percpu_value <message> (7);
+        ptr copy = original;
+        CHECK(copy.get() != original.get() && copy->intact() && copy->id == 7);
+        copy->id = 8;
+        CHECK(original->id == 7);
+    }
+}
+
+int main()
+{
+    distinct_blocks();
+    freed_on_other_threads();
+    clones();
+}
@@ -0,0 +1,70 @@
+// Built as C++14, where the slabs are aligned by hand.
+// Values held by a static object are freed in static destruction, after the main thread's magazines are gone.
+
+#include "slab_allocator.hpp"
+#include "check.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct shape : sutil::placement_cloneable <shape>
+    {
+        virtual ~shape() = default;
+        virtual int id() const = 0;
+    };
+
+    template <std::size_t Size>
+    struct blob : sutil::cloneable_impl <blob <Size>, shape>
+    {
+        unsigned char bytes[Size] = {};
+
+        int id() const override { return static_cast <int> (Size); }
+    };
+
+    using ptr = sutil::slab_value_ptr <shape>;
+
+    std::vector <ptr> make_shapes(int n)
+    {
+        std::vector <ptr> result;
+        for (int i = 0; i != n; ++i)
+        {
+            switch (i % 4)
+            {
+                case 0: result.push_back(sutil::make_slab_value <blob <8>, shape> ()); break;
+                case 1: result.push_back(sutil::make_slab_value <blob <100>, shape> ()); break;
+                case 2: result.push_back(sutil::make_slab_value <blob <1000>, shape> ()); break;
+                default: result.push_back(sutil::make_slab_value <blob <5000>, shape> ()); break;
+            }
+        }
+        return result;
+    }
+
+    // destroyed after every thread_local object of the main thread.
+    struct late_holder
+    {
+        std::vector <ptr> shapes;
+
+        ~late_holder()
+        {
+            std::vector <ptr> copies(shapes);
+            CHECK(copies.size() == shapes.size() && copies[1]->id() == 100);
+        }
+    } late;
+}
+
+int main()
+{
+    std::vector <ptr> shapes = make_shapes(2000);
+    for (std::size_t i = 0; i != shapes.size(); ++i)
+        CHECK(shapes[i]->id() == (i % 4 == 0 ? 8 : i % 4 == 1 ? 100 : i % 4 == 2 ? 1000 : 5000));
+
+    // made here, freed there.
+    std::vector <ptr> copies(shapes);
+    std::thread t([&] { copies.clear(); });
+    t.join();
+    shapes.clear();
+
+    late.shapes = make_shapes(100);
+}
@@ -0,0 +1,47 @@
+// static_value is constant-initialized, shares its prototype without allocating and clones on the first write.
+
+#include "static_value.hpp"
+#include "check.hpp"
+
+#include <type_traits>
+
+namespace
+{
+    struct config
+    {
+        int workers;
+        char const* name;
+
+        constexpr config(int w, char const* n)
+            : workers(w)
+            , name(n)
+        {
+        }
+    };
+
+    constexpr sutil::static_value <config> default_config{8, "worker"};
+
+    // usable in constant expressions, so constant-initialized.
+    static_assert(default_config->workers == 8, "constant initialization");
+    static_assert(default_config.get().name[0] == 'w', "constant initialization");
+
+    // the in-place constructor does not take a static_value, not even a non-const lvalue.
+    static_assert(!std::is_constructible <sutil::static_value <config>, sutil::static_value <config>&>::value, "no copies");
+    static_assert(!std::is_constructible <sutil::static_value <config>, sutil::static_value <config> const&>::value, "no copies");
+    static_assert(std::is_constructible <sutil::static_value <int>, int>::value, "in place");
+}
+
+int main()
+{
+    auto shared = default_config.share();
+    auto other = default_config.share();
+    CHECK(shared.get() == &default_config.get() && shared.use_count() == 0 && shared.is_shared());
+
+    shared.modify()->workers = 2;
+    CHECK(shared->workers == 2 && shared.get() != &default_config.get() && shared.use_count() == 1);
+    CHECK(default_config->workers == 8 && other.get() == &default_config.get());
+
+    auto copy = default_config.clone();
+    copy->workers = 3;
+    CHECK(default_config->workers == 8 && copy->workers == 3);
+}
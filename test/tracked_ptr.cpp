@@ -0,0 +1,126 @@
+// A small tree of tracked_ptrs and its snapshots: incremental_clone reuses the last snapshot until something
+// is modified, modifications clone only the path to the modified node, unmodified subtrees stay shared,
+// and modified_since tells the modified paths apart. Also resets a node to the pointer it holds.
+
+#include "tracked_ptr.hpp"
+#include "check.hpp"
+
+namespace
+{
+    int copies = 0;
+
+    struct node
+    {
+        int value;
+        sutil::tracked_ptr <node> left;
+        sutil::tracked_ptr <node> right;
+
+        explicit node(int v) : value(v), left(), right() {}
+        node(node const& other) : value(other.value), left(other.left), right(other.right) { ++copies; }
+    };
+
+    using ptr = sutil::tracked_ptr <node>;
+    using snapshot = ptr::snapshot_type;
+
+    // root(1) with children left(2) and right(3), and a grandchild left(4) below left.
+    ptr make_tree()
+    {
+        ptr root = sutil::make_tracked <node> (1);
+        root->left = sutil::make_tracked <node> (2);
+        root->right = sutil::make_tracked <node> (3);
+        root->left->left = sutil::make_tracked <node> (4);
+        return root;
+    }
+
+    ptr const& read(ptr const& p)
+    {
+        return p;
+    }
+
+    void reuse_until_modified()
+    {
+        ptr root = make_tree();
+        snapshot first = root.incremental_clone();
+        CHECK(first.get() == root.get());
+
+        snapshot again = root.incremental_clone(first);
+        CHECK(again.get() == first.get() && again.taken_at() == first.taken_at());
+
+        // reading does not count.
+        CHECK(read(root)->left->left->value == 4);
+        CHECK(root.incremental_clone(first).taken_at() == first.taken_at());
+
+        root->right->value = 30;
+        snapshot second = root.incremental_clone(first);
+        CHECK(second.taken_at() > first.taken_at());
+        CHECK(second->right->value == 30 && first->right->value == 3);
+    }
+
+    void clone_modified_paths_only()
+    {
+        ptr root = make_tree();
+        snapshot before = root.incremental_clone();
+        node const* old_root = root.get();
+        node const* old_left = read(root)->left.get();
+        node const* old_grandchild = read(root)->left->left.get();
+        node const* old_right = read(root)->right.get();
+        copies = 0;
+
+        root->left->left->value = 40;
+        CHECK(copies == 3); // root, left and the grandchild, right is not on the path.
+        CHECK(root.get() != old_root && read(root)->left.get() != old_left);
+        CHECK(read(root)->left->left.get() != old_grandchild);
+        CHECK(read(root)->right.get() == old_right);
+        CHECK(before.get() == old_root && before->left.get() == old_left && before->right.get() == old_right);
+        CHECK(before->left->left->value == 4 && read(root)->left->left->value == 40);
+
+        // the new snapshot shares the live tree entirely, and the untouched subtree with the old snapshot.
+        snapshot after = root.incremental_clone(before);
+        CHECK(after.get() == root.get());
+        CHECK(after->right.get() == before->right.get());
+
+        // modifying again after the snapshot clones the path once more, but nothing else.
+        copies = 0;
+        root->left->value = 20;
+        CHECK(copies == 2);
+        CHECK(after->left->value == 2 && read(root)->left->value == 20);
+    }
+
+    void modified_since()
+    {
+        ptr root = make_tree();
+        snapshot taken = root.incremental_clone();
+        CHECK(!root.modified_since(taken));
+
+        root->left->left->value = 5;
+        ptr const& live = root;
+        CHECK(live.modified_since(taken));
+        CHECK(live->left.modified_since(taken));
+        CHECK(live->left->left.modified_since(taken));
+        CHECK(!live->right.modified_since(taken));
+
+        snapshot next = root.incremental_clone(taken);
+        CHECK(!live.modified_since(next) && !live->left->left.modified_since(next));
+    }
+
+    void reset_to_held()
+    {
+        ptr root = make_tree();
+        snapshot taken = root.incremental_clone();
+        node* p = root.modify();
+        root.reset(p);
+        CHECK(root.get() == p && root->value == 1);
+        CHECK(taken->value == 1);
+
+        root->left.reset(new node(6));
+        CHECK(read(root)->left->value == 6 && taken->left->value == 2);
+    }
+}
+
+int main()
+{
+    reuse_until_modified();
+    clone_modified_paths_only();
+    modified_since();
+    reset_to_held();
+}
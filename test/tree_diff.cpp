@@ -0,0 +1,155 @@
+// tree_diff and apply_patch on trees of cow_ptrs: patching a copy of the source tree with the difference
+// must give a tree equal to the target, sharing every subtree the edit did not touch, and the diff
+// must not visit subtrees shared between source and target.
+
+#include "tree_diff.hpp"
+#include "check.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace
+{
+    int compared = 0;
+
+    struct node;
+    using ptr = sutil::cow_ptr <node>;
+
+    struct node
+    {
+        int value;
+        std::vector <ptr> children;
+
+        explicit node(int v) : value(v), children() {}
+    };
+}
+
+namespace sutil
+{
+    template <>
+    struct tree_traits <node>
+    {
+        static std::size_t child_count(node const& n) { return n.children.size(); }
+        static ptr const& child(node const& n, std::size_t index) { return n.children[index]; }
+        static ptr& child(node& n, std::size_t index) { return n.children[index]; }
+
+        static bool same_payload(node const& lhs, node const& rhs)
+        {
+            ++compared;
+            return lhs.value == rhs.value;
+        }
+    };
+}
+
+namespace
+{
+    ptr leaf(int value)
+    {
+        return sutil::make_cow <node> (value);
+    }
+
+    ptr branch(int value, std::vector <ptr> children)
+    {
+        ptr p = leaf(value);
+        p.modify()->children = std::move(children);
+        return p;
+    }
+
+    bool equal(ptr const& lhs, ptr const& rhs)
+    {
+        if (!lhs || !rhs)
+            return !lhs && !rhs;
+        if (lhs->value != rhs->value || lhs->children.size() != rhs->children.size())
+            return false;
+        for (std::size_t i = 0; i != lhs->children.size(); ++i)
+        {
+            if (!equal(lhs->children[i], rhs->children[i]))
+                return false;
+        }
+        return true;
+    }
+
+    // 1 with the children 2 (with 3 and 4), 5 (with 6) and 7.
+    ptr make_tree()
+    {
+        return branch(1, {branch(2, {leaf(3), leaf(4)}), branch(5, {leaf(6)}), leaf(7)});
+    }
+
+    void round_trip()
+    {
+        ptr const from = make_tree();
+        ptr to = from;
+        // a payload deep down, a replaced subtree, a child added and a child dropped.
+        to.modify()->children[0].modify()->children[1].modify()->value = 40;
+        to.modify()->children[1] = branch(50, {leaf(60), leaf(61)});
+        to.modify()->children[2].modify()->children.push_back(leaf(8));
+        to.modify()->children[0].modify()->children[0].reset();
+
+        sutil::tree_patch <ptr> patch = sutil::tree_diff(from, to);
+        CHECK(!patch.empty());
+
+        ptr patched = from;
+        sutil::apply_patch(patched, patch);
+        CHECK(equal(patched, to));
+        CHECK(equal(from, make_tree()));
+
+        // the patch shares the changed nodes of the target, nothing else was copied.
+        CHECK(patched->children[1].get() == to->children[1].get());
+        CHECK(patched->children[0]->children[1]->value == 40);
+
+        // payload only changes keep the patched tree's own children.
+        ptr renamed = from;
+        renamed.modify()->value = 10;
+        patch = sutil::tree_diff(from, renamed);
+        CHECK(patch.entries.size() == 1 && patch.entries[0].keep_children && patch.entries[0].path.empty());
+        patched = from;
+        sutil::apply_patch(patched, patch);
+        CHECK(patched->value == 10);
+        for (std::size_t i = 0; i != from->children.size(); ++i)
+            CHECK(patched->children[i].get() == from->children[i].get());
+    }
+
+    void shared_subtrees_are_skipped()
+    {
+        ptr const from = make_tree();
+        compared = 0;
+        CHECK(sutil::tree_diff(from, from).empty());
+        CHECK(compared == 0);
+
+        ptr to = from;
+        to.modify()->children[2].modify()->value = 70;
+        compared = 0;
+        sutil::tree_patch <ptr> patch = sutil::tree_diff(from, to);
+        // the root and the changed leaf, the subtrees below 2 and 5 are shared.
+        CHECK(compared == 2);
+        CHECK(patch.entries.size() == 1 && patch.entries[0].path == std::vector <std::size_t> {2});
+
+        ptr patched = from;
+        sutil::apply_patch(patched, patch);
+        CHECK(patched->children[2]->value == 70);
+        CHECK(patched->children[0].get() == from->children[0].get());
+        CHECK(patched->children[1].get() == from->children[1].get());
+    }
+
+    void empty_trees()
+    {
+        ptr const empty;
+        ptr const tree = make_tree();
+        sutil::tree_patch <ptr> patch = sutil::tree_diff(empty, tree);
+        CHECK(patch.entries.size() == 1 && !patch.entries[0].keep_children);
+
+        ptr patched;
+        sutil::apply_patch(patched, patch);
+        CHECK(patched.get() == tree.get());
+
+        sutil::apply_patch(patched, sutil::tree_diff(tree, empty));
+        CHECK(!patched);
+    }
+}
+
+int main()
+{
+    round_trip();
+    shared_subtrees_are_skipped();
+    empty_trees();
+}
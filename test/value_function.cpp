@@ -0,0 +1,97 @@
+#include "value_function.hpp"
+#include "check.hpp"
+
+#include <functional>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+    using int_function = sutil::value_function <int(int)>;
+
+    int twice(int x)
+    {
+        return 2 * x;
+    }
+
+    struct counter
+    {
+        int value;
+
+        int add(int x)
+        {
+            return value += x;
+        }
+    };
+
+    template <typename FunctionT>
+    bool throws_bad_function_call(FunctionT const& f)
+    {
+        try
+        {
+            f(1);
+        }
+        catch (std::bad_function_call const&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // overload resolution must only see the candidate the argument can be called as.
+    int pick(sutil::value_function <int(int)> const&) { return 1; }
+    int pick(sutil::value_function <int(std::string const&)> const&) { return 2; }
+}
+
+// the converting constructor is constrained on the signature.
+static_assert(std::is_convertible <int(*)(int), int_function>::value, "function pointer");
+static_assert(!std::is_convertible <int(*)(std::string), int_function>::value, "wrong argument type");
+static_assert(!std::is_convertible <std::string(*)(int), int_function>::value, "wrong result type");
+static_assert(!std::is_convertible <int, int_function>::value, "not callable");
+static_assert(!std::is_assignable <int_function&, int>::value, "not callable");
+static_assert(std::is_convertible <void(*)(int), sutil::value_function <void(int)> >::value, "discarded result");
+static_assert(std::is_convertible <int (counter::*)(int), sutil::value_function <int(counter&, int)> >::value, "member function");
+static_assert(std::is_convertible <int counter::*, sutil::value_function <int(counter const&)> >::value, "member object");
+
+int main()
+{
+    int_function f = &twice;
+    CHECK(f && f(21) == 42);
+    f = [](int x) { return x + 1; };
+    CHECK(f(1) == 2);
+
+    CHECK(pick([](int x) { return x; }) == 1);
+    CHECK(pick([](std::string const& s) { return static_cast <int> (s.size()); }) == 2);
+
+    // empty callables give empty value_functions.
+    int (*null_function)(int) = nullptr;
+    int_function from_null(null_function);
+    CHECK(!from_null && from_null == nullptr);
+    CHECK(throws_bad_function_call(from_null));
+
+    f = null_function;
+    CHECK(!f);
+
+    int (counter::*null_member)(int) = nullptr;
+    sutil::value_function <int(counter&, int)> from_null_member(null_member);
+    CHECK(!from_null_member);
+
+    int_function from_empty_std(std::function <int(int)>{});
+    CHECK(!from_empty_std);
+    CHECK(throws_bad_function_call(from_empty_std));
+
+    sutil::value_function <int(int), 64> from_empty_bigger(int_function{});
+    CHECK(!from_empty_bigger);
+
+    // member pointers are called like std::invoke.
+    counter c{1};
+    sutil::value_function <int(counter&, int)> add = &counter::add;
+    CHECK(add(c, 2) == 3 && c.value == 3);
+    sutil::value_function <int(counter*, int)> add_through_pointer = &counter::add;
+    CHECK(add_through_pointer(&c, 1) == 4);
+    sutil::value_function <int(counter const&)> value = &counter::value;
+    CHECK(value(c) == 4);
+
+    int_function copy = f = &twice;
+    CHECK(copy(2) == 4);
+}
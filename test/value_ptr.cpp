@@ -0,0 +1,160 @@
+// Function pointer policies: size, copying, and the assert on null policies when a pointee is set.
+// Conversions from unique_ptr and to unique_ptr and shared_ptr.
+// The last case aborts on purpose, the SIGABRT handler turns that into success.
+
+#undef NDEBUG
+
+#include "value_ptr.hpp"
+#include "check.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+    struct node
+    {
+        int value;
+    };
+
+    int clones = 0;
+    int deletes = 0;
+
+    node* clone_node(node* p)
+    {
+        ++clones;
+        return new node(*p);
+    }
+
+    void delete_node(node* p)
+    {
+        ++deletes;
+        delete p;
+    }
+
+    using runtime_ptr = sutil::value_ptr <node, node*(*)(node*), void(*)(node*)>;
+
+    static_assert(sizeof(runtime_ptr) == 3 * sizeof(void*), "two function pointer policies and the pointer");
+    static_assert(sizeof(sutil::value_ptr <node>) == sizeof(void*), "empty policies take no space");
+
+    void function_pointer_policies()
+    {
+        {
+            runtime_ptr a(new node{1}, &delete_node, &clone_node);
+            runtime_ptr b = a;
+            CHECK(b->value == 1 && b.get() != a.get() && clones == 1);
+
+            runtime_ptr c;
+            c = b;
+            CHECK(c->value == 1 && c.get_deleter() == &delete_node && clones == 2);
+
+            runtime_ptr d(std::move(c));
+            CHECK(!c && d->value == 1 && d.get_cloner() == &clone_node);
+
+            d.reset(new node{2});
+            CHECK(deletes == 1 && d->value == 2);
+            d = new node{3};
+            CHECK(deletes == 2 && d->value == 3);
+
+            // empty value_ptrs may have null policies.
+            runtime_ptr empty;
+            runtime_ptr empty_copy = empty;
+            empty.reset();
+            CHECK(!empty_copy && clones == 2);
+        }
+        CHECK(deletes == 5);
+    }
+
+    struct base
+    {
+        virtual ~base() = default;
+        virtual base* clone() const { return new base(*this); }
+    };
+
+    struct derived : base
+    {
+        derived* clone() const override { return new derived(*this); }
+    };
+
+    void delete_base(base* p)
+    {
+        delete p;
+    }
+
+    using base_ptr = sutil::value_ptr <base>;
+
+    static_assert(std::is_constructible <base_ptr, std::unique_ptr <derived> >::value, "derived pointers convert");
+    static_assert(!std::is_convertible <std::unique_ptr <base>, base_ptr>::value, "taking over a unique_ptr is explicit");
+    static_assert(!std::is_constructible <sutil::value_ptr <derived>, std::unique_ptr <base> >::value, "no downcasts");
+    static_assert(!std::is_constructible <base_ptr, std::unique_ptr <base, void(*)(base*)> >::value,
+        "the deleter must convert");
+    static_assert(std::is_constructible <sutil::value_ptr <base, sutil::default_clone <base>, void(*)(base*)>,
+        std::unique_ptr <base, void(*)(base*)> >::value, "matching deleters convert");
+
+    void unique_ptr_conversions()
+    {
+        std::unique_ptr <derived> u(new derived());
+        derived* raw = u.get();
+        base_ptr v(std::move(u));
+        CHECK(!u && v.get() == raw);
+
+        base_ptr copy = v;
+        CHECK(copy.get() != raw && dynamic_cast <derived*> (copy.get()));
+
+        std::unique_ptr <base> back = std::move(v).to_unique();
+        CHECK(!v && back.get() == raw);
+
+        sutil::value_ptr <base, sutil::default_clone <base>, void(*)(base*)> custom(
+            std::unique_ptr <base, void(*)(base*)> (new derived(), &delete_base));
+        CHECK(custom.get_deleter() == &delete_base);
+    }
+
+    void to_shared()
+    {
+        deletes = 0;
+        runtime_ptr v(new node{4}, &delete_node, &clone_node);
+        node* raw = v.get();
+        std::shared_ptr <node> shared = std::move(v).to_shared();
+        CHECK(!v && shared.get() == raw && deletes == 0);
+
+        using shared_deleter = sutil::shared_value_deleter <node, node*(*)(node*), void(*)(node*)>;
+        shared_deleter* d = std::get_deleter <shared_deleter> (shared);
+        CHECK(d && d->cloner == &clone_node && d->deleter == &delete_node);
+
+        std::shared_ptr <node> other = shared;
+        shared.reset();
+        CHECK(deletes == 0);
+        other.reset();
+        CHECK(deletes == 1);
+
+        // an empty value_ptr gives a null shared_ptr, its deleter skips the null pointer.
+        runtime_ptr empty;
+        CHECK(!std::move(empty).to_shared());
+        CHECK(deletes == 1);
+    }
+
+    extern "C" void expected_abort(int)
+    {
+        std::_Exit(EXIT_SUCCESS);
+    }
+
+    void reset_with_null_policies()
+    {
+        std::signal(SIGABRT, &expected_abort);
+        runtime_ptr v;
+        v.reset(new node{1});
+        std::signal(SIGABRT, SIG_DFL);
+        CHECK(!"reset with null policies was accepted");
+    }
+}
+
+int main()
+{
+    function_pointer_policies();
+    unique_ptr_conversions();
+    to_shared();
+    reset_with_null_policies();
+}
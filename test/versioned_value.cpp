@@ -0,0 +1,118 @@
+// Commit and pin(ts) semantics of versioned_value, and readers pinning concurrently with a writer.
+// Every version holds a vector whose elements all equal its timestamp, readers check that they never see a mix.
+
+#include "versioned_value.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using values = std::vector <std::uint64_t>;
+    using versioned = sutil::versioned_value <values>;
+
+    versioned::timestamp fill(versioned& v)
+    {
+        versioned::timestamp const next = v.latest() + 1;
+        return v.commit([next](versioned::value_type& value) {
+            for (auto& x : *value.modify())
+                x = next;
+        });
+    }
+
+    void commit_and_pin()
+    {
+        versioned v(sutil::make_cow <values> (4, 1));
+        CHECK(v.latest() == 1 && v.pin()->front() == 1);
+
+        auto first = v.pin();
+        CHECK(fill(v) == 2 && fill(v) == 3 && v.latest() == 3);
+        CHECK(first.version() == 1 && first->back() == 1);
+
+        // a commit that does not modify shares the pointee.
+        auto before = v.pin();
+        CHECK(v.commit([](versioned::value_type&) {}) == 4);
+        CHECK(v.pin()->data() == before->data() && v.pin().version() == 4);
+
+        // older versions are found while pinned.
+        CHECK(v.pin(1).version() == 1 && v.pin(1)->front() == 1);
+        CHECK(v.pin(3).version() == 3 && v.pin(100).version() == 4);
+
+        // 2 is collected: a timestamp inside its run does not fall back to version 1.
+        CHECK(!v.pin(2));
+        CHECK(!v.pin(0));
+
+        first = versioned::pinned();
+        before = versioned::pinned();
+        fill(v);
+        CHECK(!v.pin(1) && !v.pin(3) && v.pin(5).version() == 5);
+    }
+
+    void many_commits_with_old_pins()
+    {
+        versioned v(sutil::make_cow <values> (1, 1));
+        auto oldest = v.pin();
+        std::vector <versioned::pinned> every_tenth;
+        for (int i = 0; i != 1000; ++i)
+        {
+            versioned::timestamp ts = fill(v);
+            if (ts % 10 == 0)
+                every_tenth.push_back(v.pin());
+            if (every_tenth.size() > 5)
+                every_tenth.erase(every_tenth.begin());
+        }
+        CHECK(v.pin(1).version() == 1 && oldest->front() == 1);
+        for (auto const& p : every_tenth)
+        {
+            CHECK(v.pin(p.version()).version() == p.version());
+            auto next = v.pin(p.version() + 1);
+            CHECK(!next || next.version() == p.version() + 1);
+        }
+        CHECK(!v.pin(15));
+    }
+
+    void concurrent_readers()
+    {
+        versioned v(sutil::make_cow <values> (64, 1));
+        std::atomic <bool> done{false};
+        std::atomic <long> reads{0};
+
+        std::vector <std::thread> readers;
+        for (int r = 0; r != 4; ++r)
+        {
+            readers.emplace_back([&] {
+                versioned::timestamp last = 0;
+                while (!done.load(std::memory_order_acquire))
+                {
+                    auto pinned = v.pin();
+                    CHECK(pinned.version() >= last);
+                    last = pinned.version();
+                    for (auto x : *pinned)
+                        CHECK(x == last);
+                    auto older = v.pin(last - 1);
+                    if (older)
+                        CHECK(older.version() < last && older->front() == older.version());
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (int i = 0; i != 2000; ++i)
+            fill(v);
+        while (reads.load(std::memory_order_relaxed) < 100)
+            std::this_thread::yield();
+        done.store(true, std::memory_order_release);
+        for (auto& t : readers)
+            t.join();
+        CHECK(v.latest() == 2001);
+    }
+}
+
+int main()
+{
+    commit_and_pin();
+    many_commits_with_old_pins();
+    concurrent_readers();
+}
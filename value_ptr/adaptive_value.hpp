@@ -0,0 +1,394 @@
+#ifndef SIMPLE_UTIL_ADAPTIVE_VALUE_HPP_INCLUDED
+#define SIMPLE_UTIL_ADAPTIVE_VALUE_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  Copy statistics of one pointee type, shared by all adaptive_values of that type.
+     */
+    struct adaptive_statistics
+    {
+        // copies of non-empty adaptive_values.
+        std::uint64_t copies;
+        // copies that were written to afterwards, at least once.
+        std::uint64_t writes_after_copy;
+        // the same for recent copies only, older ones are weighted down. the decision is made from these.
+        std::uint64_t recent_copies;
+        std::uint64_t recent_writes_after_copy;
+        // clones, eager or on first write to a shared pointee.
+        std::uint64_t clones;
+        // moving average duration of the sampled clones, recent samples weigh most.
+        std::uint64_t average_clone_ns;
+        // the current decision: true, copies share the pointee; false, copies clone it.
+        bool copy_on_write;
+
+        double write_ratio() const noexcept
+        {
+            return copies ? static_cast <double> (writes_after_copy) / static_cast <double> (copies) : 0.0;
+        }
+
+        double recent_write_ratio() const noexcept
+        {
+            return recent_copies ? static_cast <double> (recent_writes_after_copy) / static_cast <double> (recent_copies) : 0.0;
+        }
+    };
+
+    /**
+     *  The per-type counters behind adaptive_statistics and the copy strategy decision.
+     *
+     *  Copies clone eagerly during a warmup phase, to measure the clone cost. After that copies share the pointee,
+     *  unless cloning is so cheap that sharing does not pay off, or copies are almost always written to,
+     *  so that copy-on-write would clone anyway and only add the cost of sharing.
+     *
+     *  The decision follows changes in the workload: the write share is counted over a window of recent copies,
+     *  halved whenever it fills up, and the clone cost is an exponential moving average of the samples.
+     */
+    template <typename T>
+    class adaptive_policy
+    {
+    public:
+        // copies cloned eagerly before deciding.
+        static constexpr std::uint64_t warmup_copies = 32;
+        // the first clones are all timed, every sample_interval-th after them.
+        static constexpr std::uint64_t warmup_clones = 32;
+        static constexpr std::uint64_t sample_interval = 16;
+        // clones cheaper than this are always done eagerly.
+        static constexpr std::uint64_t cheap_clone_ns = 64;
+        // copies are cloned eagerly, if at least this share of them is written to (in percent).
+        static constexpr std::uint64_t eager_write_percent = 75;
+        // the recent copy and write counts are halved when this many copies have been counted.
+        static constexpr std::uint64_t copy_window = 1024;
+        // a new clone sample moves the average by 1/clone_weight of its distance.
+        static constexpr std::uint64_t clone_weight = 8;
+
+        static adaptive_policy& instance() noexcept
+        {
+            static adaptive_policy policy;
+            return policy;
+        }
+
+        bool copy_on_write() const noexcept
+        {
+            std::uint64_t const copies = copies_.load(std::memory_order_relaxed);
+            if (copies < warmup_copies)
+                return false;
+            if (average_clone_ns_.load(std::memory_order_relaxed) < cheap_clone_ns)
+                return false;
+            return recent_writes_.load(std::memory_order_relaxed) * 100 < recent_copies_.load(std::memory_order_relaxed) * eager_write_percent;
+        }
+
+        adaptive_statistics statistics() const noexcept
+        {
+            return {
+                copies_.load(std::memory_order_relaxed),
+                writes_after_copy_.load(std::memory_order_relaxed),
+                recent_copies_.load(std::memory_order_relaxed),
+                recent_writes_.load(std::memory_order_relaxed),
+                clones_.load(std::memory_order_relaxed),
+                average_clone_ns_.load(std::memory_order_relaxed),
+                copy_on_write()
+            };
+        }
+
+        /**
+         *  Starts over, including the warmup.
+         */
+        void reset() noexcept
+        {
+            copies_.store(0, std::memory_order_relaxed);
+            writes_after_copy_.store(0, std::memory_order_relaxed);
+            recent_copies_.store(0, std::memory_order_relaxed);
+            recent_writes_.store(0, std::memory_order_relaxed);
+            clones_.store(0, std::memory_order_relaxed);
+            average_clone_ns_.store(0, std::memory_order_relaxed);
+        }
+
+        void count_copy() noexcept
+        {
+            copies_.fetch_add(1, std::memory_order_relaxed);
+            // exactly one thread fills the window each time.
+            if (recent_copies_.fetch_add(1, std::memory_order_relaxed) + 1 == copy_window)
+            {
+                recent_copies_.fetch_sub(copy_window / 2, std::memory_order_relaxed);
+                recent_writes_.fetch_sub(recent_writes_.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            }
+        }
+
+        void count_write_after_copy() noexcept
+        {
+            writes_after_copy_.fetch_add(1, std::memory_order_relaxed);
+            recent_writes_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         *  Runs clone, which must clone the pointee, timing it if it is sampled.
+         */
+        template <typename FunctionT>
+        auto timed_clone(FunctionT&& clone) -> decltype(clone())
+        {
+            std::uint64_t const n = clones_.fetch_add(1, std::memory_order_relaxed);
+            if (n >= warmup_clones && n % sample_interval != 0)
+                return clone();
+
+            auto const start = std::chrono::steady_clock::now();
+            auto result = clone();
+            auto const ns = std::chrono::duration_cast <std::chrono::nanoseconds> (std::chrono::steady_clock::now() - start).count();
+            add_clone_sample(static_cast <std::uint64_t> (ns));
+            return result;
+        }
+
+        /**
+         *  Adds a clone duration to the moving average. The first sample after a reset starts it.
+         */
+        void add_clone_sample(std::uint64_t ns) noexcept
+        {
+            std::uint64_t average = average_clone_ns_.load(std::memory_order_relaxed);
+            std::uint64_t next;
+            do
+            {
+                next = average ? average - average / clone_weight + ns / clone_weight : ns;
+            }
+            while (!average_clone_ns_.compare_exchange_weak(average, next, std::memory_order_relaxed));
+        }
+
+    private:
+        adaptive_policy() noexcept = default;
+
+    private:
+        std::atomic <std::uint64_t> copies_{0};
+        std::atomic <std::uint64_t> writes_after_copy_{0};
+        std::atomic <std::uint64_t> recent_copies_{0};
+        std::atomic <std::uint64_t> recent_writes_{0};
+        std::atomic <std::uint64_t> clones_{0};
+        std::atomic <std::uint64_t> average_clone_ns_{0};
+    };
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::warmup_copies;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::warmup_clones;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::sample_interval;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::cheap_clone_ns;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::eager_write_percent;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::copy_window;
+
+    template <typename T>
+    constexpr std::uint64_t adaptive_policy <T>::clone_weight;
+
+    /**
+     *  A value holder that picks its copy strategy per type at runtime: eager cloning through ClonerT like value_ptr,
+     *  or sharing the pointee until it is written like cow_ptr. The choice is made on every copy from
+     *  statistics collected for all adaptive_values of the pointee type, see adaptive_policy.
+     *
+     *  Read access is const. Write access goes through modify(), which clones the pointee if it is shared.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class adaptive_value
+    {
+    public:
+        using pointer = T*;
+        using const_pointer = T const*;
+        using element_type = T;
+        using value_type = cow_ptr <T, ClonerT, DeleterT>;
+        using policy_type = adaptive_policy <T>;
+
+        /**
+         *  Creates an empty adaptive_value.
+         */
+        adaptive_value() noexcept
+            : value_()
+            , copied_(false)
+        {
+        }
+
+        /**
+         *  Creates a new adaptive_value from a raw owning pointer and aquires ownership.
+         *
+         *  @param ptr The pointer to take ownership of.
+         */
+        explicit adaptive_value(T* ptr)
+            : value_(ptr)
+            , copied_(false)
+        {
+        }
+
+        /**
+         *  Takes over a cow_ptr.
+         */
+        explicit adaptive_value(value_type value) noexcept
+            : value_(std::move(value))
+            , copied_(false)
+        {
+        }
+
+        /**
+         *  Copies, by sharing or by cloning the pointee. Cannot be noexcept, because clone may throw.
+         */
+        adaptive_value(adaptive_value const& v)
+            : value_(v.copy())
+            , copied_(static_cast <bool> (value_))
+        {
+        }
+
+        adaptive_value(adaptive_value&& v) noexcept
+            : value_(std::move(v.value_))
+            , copied_(v.copied_)
+        {
+            v.copied_ = false;
+        }
+
+        /**
+         *  Copy assignment. Remains unaltered if clone throws.
+         */
+        adaptive_value& operator=(adaptive_value const& v)
+        {
+            value_type value = v.copy();
+            value_.swap(value);
+            copied_ = static_cast <bool> (value_);
+            return *this;
+        }
+
+        adaptive_value& operator=(adaptive_value&& v) noexcept
+        {
+            value_.swap(v.value_);
+            v.value_.reset();
+            copied_ = v.copied_;
+            v.copied_ = false;
+            return *this;
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        T const& operator*() const
+        {
+            return *value_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        const_pointer operator->() const
+        {
+            return value_.get();
+        }
+
+        /**
+         *  Retrieves the held pointee.
+         */
+        const_pointer get() const noexcept
+        {
+            return value_.get();
+        }
+
+        /**
+         *  Retrieves the held pointee for writing. Clones it first, if it is shared.
+         *  Cannot be noexcept, because clone may throw. The adaptive_value remains unaltered if clone throws.
+         */
+        pointer modify()
+        {
+            policy_type& policy = policy_type::instance();
+            if (value_.is_shared())
+                policy.timed_clone([this] { return value_.modify(); });
+            if (copied_)
+            {
+                copied_ = false;
+                policy.count_write_after_copy();
+            }
+            return value_.modify();
+        }
+
+        /**
+         *  Retrieves the underlying cow_ptr.
+         */
+        value_type const& value() const noexcept
+        {
+            return value_;
+        }
+
+        /**
+         *  Does the pointee share its storage with another adaptive_value?
+         */
+        bool is_shared() const noexcept
+        {
+            return value_.is_shared();
+        }
+
+        /**
+         *  The statistics the copy strategy of this type is chosen from.
+         */
+        static adaptive_statistics statistics() noexcept
+        {
+            return policy_type::instance().statistics();
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return static_cast <bool> (value_);
+        }
+
+        void reset(pointer p = pointer())
+        {
+            value_.reset(p);
+            copied_ = false;
+        }
+
+        /**
+         *  Swaps the pointee's.
+         */
+        void swap(adaptive_value& v) noexcept
+        {
+            value_.swap(v.value_);
+            std::swap(copied_, v.copied_);
+        }
+
+    private:
+        value_type copy() const
+        {
+            if (!value_)
+                return value_type();
+
+            policy_type& policy = policy_type::instance();
+            bool const share = policy.copy_on_write();
+            policy.count_copy();
+            if (share)
+                return value_;
+
+            return policy.timed_clone([this] {
+                return value_type(value_.get_cloner()(const_cast <pointer> (value_.get())), value_.get_deleter(), value_.get_cloner());
+            });
+        }
+
+    private:
+        value_type value_;
+        // made by a copy and not yet written to.
+        bool copied_;
+    };
+
+    template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
+    adaptive_value <T, ClonerT, DeleterT> make_adaptive(List&&... list)
+    {
+        return adaptive_value <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_ADAPTIVE_VALUE_HPP_INCLUDED
@@ -0,0 +1,407 @@
+#ifndef SIMPLE_UTIL_ANY_VALUE_HPP_INCLUDED
+#define SIMPLE_UTIL_ANY_VALUE_HPP_INCLUDED
+
+#include "cloner.hpp"
+
+#include <type_traits>
+#include <typeinfo>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+namespace sutil
+{
+    /**
+     *  Thrown by any_value_cast on type mismatch.
+     */
+    class bad_any_value_cast : public std::bad_cast
+    {
+    public:
+        const char* what() const noexcept override
+        {
+            return "bad any_value_cast";
+        }
+    };
+
+    namespace detail
+    {
+        union any_value_storage
+        {
+            void* heap;
+            alignas(void*) unsigned char buffer[3 * sizeof(void*)];
+        };
+
+        template <typename T>
+        struct any_value_fits_inline
+            : std::integral_constant <bool,
+                sizeof(T) <= sizeof(any_value_storage) &&
+                alignof(any_value_storage) % alignof(T) == 0 &&
+                std::is_nothrow_move_constructible <T>::value>
+        {
+        };
+
+        /**
+         *  One instance per stored type and policy pair, shared by all any_values holding that type.
+         */
+        struct any_value_vtable
+        {
+            char const* type;
+            bool stored_inline;
+            void (*copy)(any_value_storage const& from, any_value_storage& to);
+            void (*relocate)(any_value_storage& from, any_value_storage& to) noexcept;
+            void (*destroy)(any_value_storage& where) noexcept;
+        };
+
+        // the address of id identifies T. Not const, so that it is never merged with another constant.
+        template <typename T>
+        struct any_value_type_id
+        {
+            static char id;
+        };
+
+        template <typename T>
+        char any_value_type_id <T>::id = 0;
+
+        template <typename T>
+        struct any_value_inline_ops
+        {
+            static T* get(any_value_storage& where) noexcept
+            {
+                return reinterpret_cast <T*> (where.buffer);
+            }
+
+            static void copy(any_value_storage const& from, any_value_storage& to)
+            {
+                ::new (static_cast <void*> (to.buffer)) T(*get(const_cast <any_value_storage&> (from)));
+            }
+
+            static void relocate(any_value_storage& from, any_value_storage& to) noexcept
+            {
+                ::new (static_cast <void*> (to.buffer)) T(std::move(*get(from)));
+                get(from)->~T();
+            }
+
+            static void destroy(any_value_storage& where) noexcept
+            {
+                get(where)->~T();
+            }
+
+            static constexpr any_value_vtable table = {
+                &any_value_type_id <T>::id, true, &copy, &relocate, &destroy
+            };
+        };
+
+        template <typename T>
+        constexpr any_value_vtable any_value_inline_ops <T>::table;
+
+        template <typename ClonerT, typename... List>
+        auto any_value_construct_check(int) -> decltype(ClonerT::construct(std::declval <List> ()...), std::true_type());
+
+        template <typename ClonerT, typename... List>
+        std::false_type any_value_construct_check(...);
+
+        // does ClonerT create new objects itself, with a static construct(list...) like owner_clone?
+        template <typename ClonerT, typename... List>
+        struct any_value_cloner_constructs : decltype(any_value_construct_check <ClonerT, List...> (0))
+        {
+        };
+
+        template <typename T, typename ClonerT, typename DeleterT>
+        struct any_value_heap_ops
+        {
+            static void copy(any_value_storage const& from, any_value_storage& to)
+            {
+                to.heap = ClonerT()(static_cast <T*> (from.heap));
+            }
+
+            static void relocate(any_value_storage& from, any_value_storage& to) noexcept
+            {
+                to.heap = from.heap;
+            }
+
+            static void destroy(any_value_storage& where) noexcept
+            {
+                DeleterT()(static_cast <T*> (where.heap));
+            }
+
+            static constexpr any_value_vtable table = {
+                &any_value_type_id <T>::id, false, &copy, &relocate, &destroy
+            };
+        };
+
+        template <typename T, typename ClonerT, typename DeleterT>
+        constexpr any_value_vtable any_value_heap_ops <T, ClonerT, DeleterT>::table;
+    }
+
+    /**
+     *  A type-erased holder with value semantics, like std::any.
+     *  Small, nothrow movable objects are stored inline, everything else is put on the heap,
+     *  where it is copied with a ClonerT and destroyed with a DeleterT, as with value_ptr.
+     *  Both policies must be stateless, they are default constructed where needed.
+     *  Heap objects are created with ClonerT::construct(list...) if the cloner has one (owner_clone, percpu_clone),
+     *  so that they come from the memory DeleterT returns them to. Otherwise they are created with new,
+     *  and DeleterT must be std::default_delete.
+     */
+    class any_value
+    {
+    public:
+        /**
+         *  Creates an empty any_value.
+         */
+        constexpr any_value() noexcept
+            : vtable_(nullptr)
+            , storage_()
+        {
+        }
+
+        /**
+         *  Copies the held object. Cannot be noexcept, because clone may throw.
+         *  The source remains unaltered if clone throws.
+         */
+        any_value(any_value const& other)
+            : vtable_(nullptr)
+        {
+            if (other.vtable_)
+            {
+                other.vtable_->copy(other.storage_, storage_);
+                vtable_ = other.vtable_;
+            }
+        }
+
+        /**
+         *  Moves the held object over, other is empty afterwards.
+         */
+        any_value(any_value&& other) noexcept
+            : vtable_(nullptr)
+        {
+            take(other);
+        }
+
+        /**
+         *  Stores a copy of value.
+         */
+        template <typename ValueT,
+                  typename = typename std::enable_if <!std::is_same <typename std::decay <ValueT>::type, any_value>::value>::type>
+        any_value(ValueT&& value)
+            : vtable_(nullptr)
+        {
+            emplace <typename std::decay <ValueT>::type> (std::forward <ValueT> (value));
+        }
+
+        /**
+         *  "Clone" assignment.
+         */
+        any_value& operator=(any_value const& other)
+        {
+            any_value(other).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Move assignment.
+         */
+        any_value& operator=(any_value&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        /**
+         *  Replacing assignment, destroys the previously held object.
+         */
+        template <typename ValueT,
+                  typename = typename std::enable_if <!std::is_same <typename std::decay <ValueT>::type, any_value>::value>::type>
+        any_value& operator=(ValueT&& value)
+        {
+            any_value(std::forward <ValueT> (value)).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Destroys the held object and constructs a new one in place.
+         *  ClonerT and DeleterT are used if the object does not fit the inline buffer.
+         */
+        template <typename ValueT,
+                  typename ClonerT = copy_clone <ValueT>,
+                  typename DeleterT = std::default_delete <ValueT>,
+                  typename... List>
+        ValueT& emplace(List&&... list)
+        {
+            reset();
+            return construct <ValueT, ClonerT, DeleterT> (detail::any_value_fits_inline <ValueT> (), std::forward <List> (list)...);
+        }
+
+        /**
+         *  Destroys the held object.
+         */
+        void reset() noexcept
+        {
+            if (vtable_)
+            {
+                vtable_->destroy(storage_);
+                vtable_ = nullptr;
+            }
+        }
+
+        /**
+         *  Swaps the held objects.
+         */
+        void swap(any_value& other) noexcept
+        {
+            if (this == &other)
+                return;
+            any_value temp(std::move(other));
+            other.take(*this);
+            take(temp);
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        bool has_value() const noexcept
+        {
+            return vtable_ != nullptr;
+        }
+
+        /**
+         *  Does it hold an object of type ValueT? No RTTI involved.
+         */
+        template <typename ValueT>
+        bool holds() const noexcept
+        {
+            return vtable_ && vtable_->type == &detail::any_value_type_id <ValueT>::id;
+        }
+
+        /**
+         *  Was the held object put on the heap?
+         */
+        bool is_heap_allocated() const noexcept
+        {
+            return vtable_ && !vtable_->stored_inline;
+        }
+
+        /**
+         *  Retrieves the held object, or nullptr if it is not of type ValueT.
+         */
+        template <typename ValueT>
+        ValueT* get_if() noexcept
+        {
+            if (!holds <ValueT> ())
+                return nullptr;
+            if (vtable_->stored_inline)
+                return reinterpret_cast <ValueT*> (storage_.buffer);
+            return static_cast <ValueT*> (storage_.heap);
+        }
+
+        /**
+         *  Retrieves the held object, or nullptr if it is not of type ValueT.
+         */
+        template <typename ValueT>
+        ValueT const* get_if() const noexcept
+        {
+            return const_cast <any_value*> (this)->get_if <ValueT> ();
+        }
+
+        /**
+         *  Destructor.
+         */
+        ~any_value()
+        {
+            reset();
+        }
+
+    private:
+        template <typename ValueT, typename ClonerT, typename DeleterT, typename... List>
+        ValueT& construct(std::true_type /* inline */, List&&... list)
+        {
+            ValueT* p = ::new (static_cast <void*> (storage_.buffer)) ValueT(std::forward <List> (list)...);
+            vtable_ = &detail::any_value_inline_ops <ValueT>::table;
+            return *p;
+        }
+
+        template <typename ValueT, typename ClonerT, typename DeleterT, typename... List>
+        ValueT& construct(std::false_type /* heap */, List&&... list)
+        {
+            ValueT* p = allocate <ValueT, ClonerT, DeleterT> (detail::any_value_cloner_constructs <ClonerT, List...> (),
+                                                              std::forward <List> (list)...);
+            storage_.heap = p;
+            vtable_ = &detail::any_value_heap_ops <ValueT, ClonerT, DeleterT>::table;
+            return *p;
+        }
+
+        template <typename ValueT, typename ClonerT, typename DeleterT, typename... List>
+        static ValueT* allocate(std::true_type /* cloner constructs */, List&&... list)
+        {
+            return ClonerT::construct(std::forward <List> (list)...);
+        }
+
+        template <typename ValueT, typename ClonerT, typename DeleterT, typename... List>
+        static ValueT* allocate(std::false_type /* cloner constructs */, List&&... list)
+        {
+            static_assert(std::is_same <DeleterT, std::default_delete <ValueT> >::value,
+                "heap objects are created with new unless ClonerT has a construct function, DeleterT must match");
+            return new ValueT(std::forward <List> (list)...);
+        }
+
+        // requires *this to be empty.
+        void take(any_value& other) noexcept
+        {
+            if (other.vtable_)
+            {
+                other.vtable_->relocate(other.storage_, storage_);
+                vtable_ = other.vtable_;
+                other.vtable_ = nullptr;
+            }
+        }
+
+    private:
+        detail::any_value_vtable const* vtable_;
+        detail::any_value_storage storage_;
+    };
+
+    /**
+     *  Retrieves the held object, or nullptr if it is not of type ValueT.
+     */
+    template <typename ValueT>
+    ValueT* any_value_cast(any_value* v) noexcept
+    {
+        return v ? v->get_if <ValueT> () : nullptr;
+    }
+
+    /**
+     *  Retrieves the held object, or nullptr if it is not of type ValueT.
+     */
+    template <typename ValueT>
+    ValueT const* any_value_cast(any_value const* v) noexcept
+    {
+        return v ? v->get_if <ValueT> () : nullptr;
+    }
+
+    /**
+     *  Retrieves a copy of the held object. Throws bad_any_value_cast if it is not of type ValueT.
+     */
+    template <typename ValueT>
+    ValueT any_value_cast(any_value const& v)
+    {
+        using value_type = typename std::remove_cv <typename std::remove_reference <ValueT>::type>::type;
+        value_type const* p = v.get_if <value_type> ();
+        if (!p)
+            throw bad_any_value_cast{};
+        return static_cast <ValueT> (*p);
+    }
+
+    template <typename ValueT, typename ClonerT = copy_clone <ValueT>, typename DeleterT = std::default_delete <ValueT>, typename... List>
+    any_value make_any_value(List&&... list)
+    {
+        any_value v;
+        v.emplace <ValueT, ClonerT, DeleterT> (std::forward <List> (list)...);
+        return v;
+    }
+}
+
+#endif // SIMPLE_UTIL_ANY_VALUE_HPP_INCLUDED
@@ -0,0 +1,274 @@
+#ifndef SIMPLE_UTIL_BATCH_VALUE_HPP_INCLUDED
+#define SIMPLE_UTIL_BATCH_VALUE_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <set>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace sutil
+{
+    namespace detail
+    {
+        // the shared allocation behind a batch from make_values. the objects follow the header.
+        // counts the objects still alive in it and the deleters from make_values that still point to it.
+        struct batch_block
+        {
+            std::atomic <std::size_t> refs;
+            std::size_t bytes;
+            std::size_t align;
+
+            static std::size_t header_size(std::size_t align) noexcept
+            {
+                return (sizeof(batch_block) + align - 1) / align * align;
+            }
+
+            /**
+             *  Allocates a block for n objects and registers it. Throws std::bad_array_new_length
+             *  if the size overflows, and std::bad_alloc if the system is out of memory.
+             */
+            static batch_block* create(std::size_t n, std::size_t size, std::size_t align)
+            {
+                if (align < alignof(batch_block))
+                    align = alignof(batch_block);
+                std::size_t const header = header_size(align);
+                std::size_t const max = std::numeric_limits <std::size_t>::max();
+                // refs counts each object and its deleter.
+                if (n > max / 2 || n > (max - header) / size)
+                    throw std::bad_array_new_length();
+                std::size_t const bytes = header + n * size;
+#if defined(__cpp_aligned_new)
+                void* mem = align > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                    ? ::operator new(bytes, std::align_val_t(align))
+                    : ::operator new(bytes);
+#else
+                void* mem = ::operator new(bytes);
+#endif
+                batch_block* block = ::new (mem) batch_block{{2 * n}, bytes, align};
+                struct free_guard
+                {
+                    batch_block* block;
+
+                    ~free_guard()
+                    {
+                        if (block)
+                            block->free();
+                    }
+                } guard{block};
+                registry& r = blocks();
+                std::lock_guard <std::mutex> lock(r.mutex);
+                r.live.insert(block);
+                guard.block = nullptr;
+                return block;
+            }
+
+            /**
+             *  The registered block p points into, or nullptr.
+             */
+            static batch_block* find(void const* p) noexcept
+            {
+                registry& r = blocks();
+                std::lock_guard <std::mutex> lock(r.mutex);
+                auto i = r.live.upper_bound(static_cast <batch_block*> (const_cast <void*> (p)));
+                if (i == r.live.begin())
+                    return nullptr;
+                --i;
+                return (*i)->contains(p) ? *i : nullptr;
+            }
+
+            unsigned char* objects() noexcept
+            {
+                return reinterpret_cast <unsigned char*> (this) + header_size(align);
+            }
+
+            // does p point into the objects of this block?
+            bool contains(void const* p) const noexcept
+            {
+                std::less <void const*> const less;
+                unsigned char const* self = reinterpret_cast <unsigned char const*> (this);
+                return !less(p, self + header_size(align)) && less(p, self + bytes);
+            }
+
+            // an object or deleter of the block is gone, frees the block with the last one.
+            void release() noexcept
+            {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    return;
+                {
+                    registry& r = blocks();
+                    std::lock_guard <std::mutex> lock(r.mutex);
+                    r.live.erase(this);
+                }
+                free();
+            }
+
+        private:
+            // the live blocks, ordered by address. never destroyed.
+            struct registry
+            {
+                std::mutex mutex;
+                std::set <batch_block*, std::less <batch_block*> > live;
+            };
+
+            static registry& blocks()
+            {
+                static registry* r = new registry();
+                return *r;
+            }
+
+            void free() noexcept
+            {
+                std::size_t const a = align;
+                std::size_t const n = bytes;
+                this->~batch_block();
+#if defined(__cpp_aligned_new)
+                if (a > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                    return ::operator delete(this, n, std::align_val_t(a));
+#endif
+                static_cast <void> (a);
+#if defined(__cpp_sized_deallocation)
+                ::operator delete(this, n);
+#else
+                static_cast <void> (n);
+                ::operator delete(this);
+#endif
+            }
+        };
+    }
+
+    /**
+     *  Deleter for value_ptrs made by make_values. Each batch is freed when the last of its objects
+     *  and of the deleters make_values created for them is destroyed.
+     *
+     *  A deleter from make_values knows the batch of its object and destroys it in place without a lookup.
+     *  Any other deleter, a copy (clones are allocated with new and get a copy of the deleter) or one that has already
+     *  destroyed its object, checks whether the object is in a live batch, under a lock, and destroys it in place
+     *  or deletes it. So a value_ptr may be reset to objects from new as well as to objects released from any batch,
+     *  and clones do not keep their batch alive.
+     */
+    template <typename T>
+    struct batch_delete {
+        constexpr batch_delete() noexcept = default;
+
+        // takes over one of the block's references for deleters.
+        explicit batch_delete(detail::batch_block* block) noexcept
+            : block_(block)
+        {
+        }
+
+        batch_delete(batch_delete const&) noexcept
+            : block_(nullptr)
+        {
+        }
+
+        batch_delete(batch_delete&& other) noexcept
+            : block_(other.block_)
+        {
+            other.block_ = nullptr;
+        }
+
+        batch_delete& operator=(batch_delete const&) noexcept
+        {
+            forget();
+            return *this;
+        }
+
+        batch_delete& operator=(batch_delete&& other) noexcept
+        {
+            if (this != &other)
+            {
+                forget();
+                block_ = other.block_;
+                other.block_ = nullptr;
+            }
+            return *this;
+        }
+
+        ~batch_delete()
+        {
+            forget();
+        }
+
+        void operator()(T* p) const noexcept {
+            if (!p)
+                return;
+            // the value_ptr may have been released and reset to another object since make_values.
+            detail::batch_block* block = block_ && block_->contains(p) ? block_ : detail::batch_block::find(p);
+            if (!block)
+                delete p;
+            else
+            {
+                p->~T();
+                block->release();
+            }
+            // whatever the value_ptr holds next, this deleter did not see it come.
+            forget();
+        }
+
+    private:
+        void forget() const noexcept
+        {
+            if (block_)
+                block_->release();
+            block_ = nullptr;
+        }
+
+        // the batch of the object from make_values, nullptr once that is gone.
+        mutable detail::batch_block* block_ = nullptr;
+    };
+
+    template <typename T, typename ClonerT = default_clone <T> >
+    using batch_value_ptr = value_ptr <T, ClonerT, batch_delete <T> >;
+
+    /**
+     *  Creates n Ts, each constructed from list, stored contiguously in a single allocation.
+     *  Each is owned by its own value_ptr, the allocation is released when the last of the objects is destroyed.
+     *  Copies of the value_ptrs are cloned as usual, allocated on their own and do not keep the batch alive.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename... List>
+    std::vector <batch_value_ptr <T, ClonerT> > make_values(std::size_t n, List const&... list)
+    {
+        std::vector <batch_value_ptr <T, ClonerT> > result;
+        if (n == 0)
+            return result;
+        result.reserve(n);
+
+        // destroys what was constructed and frees the block, if a constructor throws.
+        struct construction_guard
+        {
+            detail::batch_block* block;
+            T* objects;
+            std::size_t constructed;
+
+            ~construction_guard()
+            {
+                if (!block)
+                    return;
+                while (constructed != 0)
+                    objects[--constructed].~T();
+                block->refs.store(1, std::memory_order_relaxed);
+                block->release();
+            }
+        };
+
+        detail::batch_block* block = detail::batch_block::create(n, sizeof(T), alignof(T));
+        construction_guard guard{block, reinterpret_cast <T*> (block->objects()), 0};
+        for (; guard.constructed != n; ++guard.constructed)
+            ::new (guard.objects + guard.constructed) T(list...);
+        T* objects = guard.objects;
+        guard.block = nullptr;
+
+        for (std::size_t i = 0; i != n; ++i)
+            result.emplace_back(objects + i, batch_delete <T> (block));
+        return result;
+    }
+}
+
+#endif // SIMPLE_UTIL_BATCH_VALUE_HPP_INCLUDED
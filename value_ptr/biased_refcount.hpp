@@ -0,0 +1,347 @@
+#ifndef SIMPLE_UTIL_BIASED_REFCOUNT_HPP_INCLUDED
+#define SIMPLE_UTIL_BIASED_REFCOUNT_HPP_INCLUDED
+
+#include "cloneable.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  A biased reference count for shared_cloneable, for objects that are mostly shared on the thread that created them.
+     *
+     *  The creating thread (the owner) counts its references in a plain counter, other threads count theirs
+     *  in an atomic counter, which may become negative when they drop references the owner handed out.
+     *  The first time that happens, the object is queued to the owner, who merges its counter into the atomic one
+     *  the next time it drops a reference (or calls collect()). The owner also merges when its own count
+     *  drops to zero. After the merge, all threads use the atomic counter. When the owner thread exits,
+     *  it merges everything queued, and objects queued later are merged by the queuing thread.
+     *  Objects created by a thread after its thread_local state is destroyed are counted atomically from the start.
+     *
+     *  The queue is linked through the objects, so queuing never allocates. Objects whose last reference is dropped
+     *  during a merge are deleted as their clone base (the BaseT of shared_cloneable <BaseT, biased_refcount>),
+     *  through its virtual destructor, and not through the deleter of the pointer holding them.
+     *  The count adds no virtual functions, shared_cloneable binds it to BaseT (see bind).
+     */
+    class biased_refcount
+    {
+    public:
+        /**
+         *  The base shared_cloneable <BaseT, biased_refcount> derives from. Knows how to delete a BaseT.
+         */
+        template <typename BaseT>
+        class bind;
+
+        void add_ref() const noexcept
+        {
+            if (is_owner())
+                biased_.store(biased_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            else
+                shared_.fetch_add(count_step, std::memory_order_relaxed);
+        }
+
+        /**
+         *  Drops a reference. Returns true if it was the last one, the caller must then destroy the object.
+         */
+        bool release_ref() const noexcept
+        {
+            if (!is_owner())
+                return release_shared();
+
+            owner_->collect_if_pending();
+            if (merged())
+                return release_shared(); // merged by the collection.
+
+            long const biased = biased_.load(std::memory_order_relaxed) - 1;
+            biased_.store(biased, std::memory_order_release);
+            if (biased != 0)
+                return false;
+
+            // the owner gives up its share, all later counting is atomic.
+            long const old = shared_.fetch_or(merged_flag, std::memory_order_acq_rel);
+            if (old & queued_flag)
+                return false; // the owner's queue decides.
+            return count_of(old) == 0;
+        }
+
+        long use_count() const noexcept
+        {
+            long const shared = shared_.load(std::memory_order_acquire);
+            return (shared & merged_flag) ? count_of(shared) : biased_.load(std::memory_order_acquire) + count_of(shared);
+        }
+
+        /**
+         *  Merges the objects queued to the calling thread.
+         */
+        static void collect() noexcept
+        {
+            if (owner_record* record = owner_record::existing())
+                record->collect();
+        }
+
+    protected:
+        using destroy_function = void (*)(biased_refcount const*);
+
+        /**
+         *  Creates the calling thread's record on its first object, which may throw std::bad_alloc.
+         */
+        explicit biased_refcount(destroy_function destroy)
+            : owner_(owner_record::current())
+            , biased_(1)
+            , shared_(0)
+            , next_queued_(nullptr)
+            , destroy_(destroy)
+        {
+            if (!owner_)
+            {
+                // the thread's state is gone, nobody can be the owner.
+                owner_ = owner_record::orphan();
+                biased_.store(0, std::memory_order_relaxed);
+                shared_.store(count_step | merged_flag, std::memory_order_relaxed);
+            }
+            owner_->acquire();
+        }
+
+        biased_refcount(biased_refcount const& other)
+            : biased_refcount(other.destroy_)
+        {
+        }
+
+        biased_refcount& operator=(biased_refcount const&) noexcept
+        {
+            return *this;
+        }
+
+        ~biased_refcount()
+        {
+            owner_->release();
+        }
+
+    private:
+        static constexpr long merged_flag = 1;
+        static constexpr long queued_flag = 2;
+        static constexpr long count_step = 4;
+
+        static long count_of(long value) noexcept
+        {
+            return (value - (value & (merged_flag | queued_flag))) / count_step;
+        }
+
+        // a thread that owns objects. lives as long as the thread or any object it owns.
+        class owner_record
+        {
+        public:
+            /**
+             *  The calling thread's record, created on first use. nullptr once its thread_local state is destroyed.
+             */
+            static owner_record* current()
+            {
+                owner_record* const record = current_record();
+                if (record || torn_down())
+                    return record;
+                thread_local handle h;
+                return h.record;
+            }
+
+            /**
+             *  The calling thread's record, if it has one. Never allocates.
+             */
+            static owner_record* existing() noexcept
+            {
+                return current_record();
+            }
+
+            /**
+             *  The owner of objects created without a thread record. Never destroyed.
+             */
+            static owner_record* orphan()
+            {
+                static owner_record* const record = new owner_record(true);
+                return record;
+            }
+
+            void acquire() noexcept
+            {
+                refs_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release() noexcept
+            {
+                if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    delete this;
+            }
+
+            void enqueue(biased_refcount const* object) noexcept
+            {
+                std::unique_lock <std::mutex> lock(mutex_);
+                if (closed_)
+                {
+                    // nobody counts on the owner's side anymore, merge right here.
+                    lock.unlock();
+                    object->merge();
+                    return;
+                }
+                object->next_queued_ = queue_;
+                queue_ = object;
+                pending_.store(true, std::memory_order_release);
+            }
+
+            void collect_if_pending() noexcept
+            {
+                if (pending_.load(std::memory_order_acquire))
+                    collect();
+            }
+
+            void collect() noexcept
+            {
+                biased_refcount const* object;
+                {
+                    std::lock_guard <std::mutex> lock(mutex_);
+                    object = queue_;
+                    queue_ = nullptr;
+                    pending_.store(false, std::memory_order_relaxed);
+                }
+                while (object)
+                {
+                    // merging may destroy the object.
+                    biased_refcount const* next = object->next_queued_;
+                    object->merge();
+                    object = next;
+                }
+            }
+
+        private:
+            struct handle
+            {
+                owner_record* record;
+
+                handle()
+                    : record(new owner_record(false))
+                {
+                    current_record() = record;
+                }
+
+                ~handle()
+                {
+                    current_record() = nullptr;
+                    torn_down() = true;
+                    {
+                        std::lock_guard <std::mutex> lock(record->mutex_);
+                        record->closed_ = true;
+                    }
+                    record->collect();
+                    record->release();
+                }
+            };
+
+            // trivially destructible, so that they can still be read after the handle is destroyed.
+            static owner_record*& current_record() noexcept
+            {
+                thread_local owner_record* record = nullptr;
+                return record;
+            }
+
+            static bool& torn_down() noexcept
+            {
+                thread_local bool destroyed = false;
+                return destroyed;
+            }
+
+            explicit owner_record(bool closed) noexcept
+                : refs_(1)
+                , pending_(false)
+                , mutex_()
+                , queue_(nullptr)
+                , closed_(closed)
+            {
+            }
+
+        private:
+            std::atomic <long> refs_;
+            std::atomic <bool> pending_;
+            std::mutex mutex_;
+            // linked through next_queued_.
+            biased_refcount const* queue_;
+            bool closed_;
+        };
+
+        bool merged() const noexcept
+        {
+            return (shared_.load(std::memory_order_relaxed) & merged_flag) != 0;
+        }
+
+        bool is_owner() const noexcept
+        {
+            // a thread without a record owns nothing.
+            return owner_ == owner_record::existing() && !merged();
+        }
+
+        bool release_shared() const noexcept
+        {
+            long old = shared_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                long desired = old - count_step;
+                bool const queue = count_of(desired) < 0 && !(old & (merged_flag | queued_flag));
+                if (queue)
+                    desired |= queued_flag;
+                if (shared_.compare_exchange_weak(old, desired, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    if (queue)
+                    {
+                        owner_->enqueue(this);
+                        return false;
+                    }
+                    return (desired & merged_flag) && !(desired & queued_flag) && count_of(desired) == 0;
+                }
+            }
+        }
+
+        // adds the owner's count to the atomic one and dequeues. destroys the object if nothing is left.
+        void merge() const noexcept
+        {
+            long old = shared_.load(std::memory_order_relaxed);
+            long desired;
+            do
+            {
+                // the owner's count is already in, if the owner merged when it dropped to zero.
+                long const biased = (old & merged_flag) ? 0 : biased_.load(std::memory_order_acquire);
+                desired = ((old + biased * count_step) | merged_flag) & ~queued_flag;
+            }
+            while (!shared_.compare_exchange_weak(old, desired, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+            if (count_of(desired) == 0)
+                destroy_(this);
+        }
+
+    private:
+        owner_record* owner_;
+        // owner thread only, atomic so that use_count() may read it anywhere.
+        mutable std::atomic <long> biased_;
+        // the other threads' count, with the merged and queued flags.
+        mutable std::atomic <long> shared_;
+        mutable biased_refcount const* next_queued_;
+        destroy_function destroy_;
+    };
+
+    template <typename BaseT>
+    class biased_refcount::bind : public biased_refcount
+    {
+    protected:
+        bind()
+            : biased_refcount(&destroy)
+        {
+        }
+
+    private:
+        // BaseT derives from bind <BaseT> through shared_cloneable, and has a virtual destructor through cloneable.
+        static void destroy(biased_refcount const* object) noexcept
+        {
+            delete static_cast <BaseT const*> (static_cast <bind const*> (object));
+        }
+    };
+}
+
+#endif // SIMPLE_UTIL_BIASED_REFCOUNT_HPP_INCLUDED
@@ -1,7 +1,12 @@
 #ifndef SIMPLE_UTIL_CLONEABLE_HPP_INCLUDED
 #define SIMPLE_UTIL_CLONEABLE_HPP_INCLUDED
 
+#include "config.hpp"
+
+#include <atomic>
 #include <utility>
+#include <new>
+#include <cstddef>
 
 namespace sutil
 {
@@ -13,7 +18,179 @@ namespace sutil
         using clone_base = BaseT;
 
         virtual BaseT* clone() const = 0;
-        virtual ~cloneable() = default;
+        SUTIL_CONSTEXPR20 virtual ~cloneable() = default;
+    };
+
+    /**
+     *  Reference count for shared_cloneable objects that are shared between threads.
+     *  Starts at 1, for the owner that created the object. A copy of an object is a new object,
+     *  its count starts at 1 as well, and assignment leaves the count alone.
+     */
+    class atomic_refcount
+    {
+    public:
+        atomic_refcount() noexcept
+            : count_(1)
+        {
+        }
+
+        atomic_refcount(atomic_refcount const&) noexcept
+            : count_(1)
+        {
+        }
+
+        atomic_refcount& operator=(atomic_refcount const&) noexcept
+        {
+            return *this;
+        }
+
+        void add_ref() const noexcept
+        {
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         *  Drops a reference. Returns true if it was the last one, the caller must then destroy the object.
+         */
+        bool release_ref() const noexcept
+        {
+            return count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        long use_count() const noexcept
+        {
+            return count_.load(std::memory_order_acquire);
+        }
+
+    private:
+        mutable std::atomic <long> count_;
+    };
+
+    /**
+     *  Reference count for shared_cloneable objects that never leave their thread. Same interface as atomic_refcount.
+     */
+    class plain_refcount
+    {
+    public:
+        plain_refcount() noexcept
+            : count_(1)
+        {
+        }
+
+        plain_refcount(plain_refcount const&) noexcept
+            : count_(1)
+        {
+        }
+
+        plain_refcount& operator=(plain_refcount const&) noexcept
+        {
+            return *this;
+        }
+
+        void add_ref() const noexcept
+        {
+            ++count_;
+        }
+
+        bool release_ref() const noexcept
+        {
+            return --count_ == 0;
+        }
+
+        long use_count() const noexcept
+        {
+            return count_;
+        }
+
+    private:
+        mutable long count_;
+    };
+
+    namespace detail
+    {
+        template <typename...>
+        struct make_void
+        {
+            using type = void;
+        };
+
+        // the base class shared_cloneable takes the reference count from: RefCountT itself,
+        // or RefCountT::bind <BaseT> for counts that destroy objects themselves (biased_refcount).
+        template <typename RefCountT, typename BaseT, typename = void>
+        struct refcount_base
+        {
+            using type = RefCountT;
+        };
+
+        template <typename RefCountT, typename BaseT>
+        struct refcount_base <RefCountT, BaseT, typename make_void <typename RefCountT::template bind <BaseT> >::type>
+        {
+            using type = typename RefCountT::template bind <BaseT>;
+        };
+    }
+
+    /**
+     *  A cloneable with an embedded reference count, for intrusive_cow_ptr.
+     *  Shared objects need neither a control block nor a second pointer.
+     */
+    template <typename BaseT, typename RefCountT = atomic_refcount>
+    class shared_cloneable : public cloneable <BaseT>, public detail::refcount_base <RefCountT, BaseT>::type
+    {
+    public:
+        using refcount_type = RefCountT;
+    };
+
+    /**
+     *  A cloneable that knows the size and alignment of its dynamic type
+     *  and can clone into storage provided by the caller.
+     */
+    template <typename BaseT>
+    class placement_cloneable : public cloneable <BaseT>
+    {
+    public:
+        virtual std::size_t dynamic_size() const noexcept = 0;
+        virtual std::size_t dynamic_alignment() const noexcept = 0;
+
+        /**
+         *  Copy constructs the dynamic type into storage.
+         *  storage must be at least dynamic_size() bytes big and aligned to dynamic_alignment().
+         */
+        virtual BaseT* clone_into(void* storage) const = 0;
+    };
+
+    /**
+     *  Implements clone and the placement_cloneable functions for DerivedT:
+     *
+     *      class circle : public sutil::cloneable_impl <circle, shape> { ... };
+     *
+     *  where shape derives from placement_cloneable <shape>.
+     */
+    template <typename DerivedT, typename BaseT>
+    class cloneable_impl : public BaseT
+    {
+    public:
+        using BaseT::BaseT;
+        using clone_base = typename BaseT::clone_base;
+
+        SUTIL_CONSTEXPR20 clone_base* clone() const override
+        {
+            return new DerivedT(static_cast <DerivedT const&> (*this));
+        }
+
+        std::size_t dynamic_size() const noexcept override
+        {
+            return sizeof(DerivedT);
+        }
+
+        std::size_t dynamic_alignment() const noexcept override
+        {
+            return alignof(DerivedT);
+        }
+
+        clone_base* clone_into(void* storage) const override
+        {
+            return ::new (storage) DerivedT(static_cast <DerivedT const&> (*this));
+        }
     };
 }
 
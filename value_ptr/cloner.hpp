@@ -5,9 +5,58 @@
 
 #include <type_traits>
 #include <utility>
+#include <system_error>
+#include <exception>
+#include <new>
+#include <cstddef>
+#include <cstring>
 
 namespace sutil
 {
+    /**
+     *  How default_clone copies a T.
+     */
+    enum class clone_strategy
+    {
+        // T has a clone() member, usually from cloneable. the only choice for polymorphic types.
+        member_clone,
+        // new T(*other).
+        copy_construct,
+        // operator new and memcpy, for trivially copyable and copy constructible types without class specific allocation.
+        copy_bytes
+    };
+
+    namespace detail
+    {
+        template <typename T, typename = void>
+        struct has_clone_member : std::false_type {};
+
+        template <typename T>
+        struct has_clone_member <T, decltype(static_cast <void> (std::declval <T const&> ().clone()))> : std::true_type {};
+
+        template <typename T, typename = void>
+        struct has_class_operator_new : std::false_type {};
+
+        template <typename T>
+        struct has_class_operator_new <T, decltype(static_cast <void> (T::operator new(std::size_t())))> : std::true_type {};
+
+        template <typename T>
+        struct default_clone_strategy : std::integral_constant <clone_strategy,
+            has_clone_member <T>::value ? clone_strategy::member_clone :
+            std::is_trivially_copyable <T>::value && std::is_copy_constructible <T>::value &&
+                !has_class_operator_new <T>::value ? clone_strategy::copy_bytes :
+            clone_strategy::copy_construct>
+        {
+            static_assert(has_clone_member <T>::value || !std::is_polymorphic <T>::value,
+                "polymorphic types need a clone() member (see cloneable), or copy_clone to slice deliberately");
+        };
+    }
+
+    /**
+     *  The default cloner. Chooses at compile time how to copy, see clone_strategy:
+     *  clone() if T has one, allocation and memcpy for trivially copyable types, copy construction otherwise.
+     *  The latter two are direct calls, no virtual dispatch is involved.
+     */
     template <typename T>
     struct default_clone {
         constexpr default_clone() noexcept = default;
@@ -17,11 +66,145 @@ namespace sutil
         constexpr default_clone(default_clone <U> const&) noexcept {}
 
         template <typename U>
-        default_clone& operator=(default_clone <U> const&) { return *this; }
+        SUTIL_CONSTEXPR20 default_clone& operator=(default_clone <U> const&) { return *this; }
 
-        T* operator()(T* other) const {
+        SUTIL_CONSTEXPR20 T* operator()(T* other) const {
+            return clone(other, std::integral_constant <clone_strategy, detail::default_clone_strategy <T>::value> ());
+        }
+
+    private:
+        static SUTIL_CONSTEXPR20 T* clone(T* other, std::integral_constant <clone_strategy, clone_strategy::member_clone>) {
             return other->clone();
         }
+
+        static SUTIL_CONSTEXPR20 T* clone(T* other, std::integral_constant <clone_strategy, clone_strategy::copy_construct>) {
+            return new T(*other);
+        }
+
+        static SUTIL_CONSTEXPR20 T* clone(T* other, std::integral_constant <clone_strategy, clone_strategy::copy_bytes>) {
+#if defined(__cpp_lib_is_constant_evaluated)
+            if (std::is_constant_evaluated())
+                return new T(*other);
+#endif
+            // allocated like new T would, so that delete releases it.
+#if defined(__cpp_aligned_new)
+            void* mem = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                ? ::operator new(sizeof(T), std::align_val_t(alignof(T)))
+                : ::operator new(sizeof(T));
+#else
+            void* mem = ::operator new(sizeof(T));
+#endif
+            std::memcpy(mem, static_cast <void const*> (other), sizeof(T));
+            return static_cast <T*> (mem);
+        }
+    };
+
+    /**
+     *  Clones by copy construction, for types that are not cloneable.
+     *  Slices polymorphic objects, the static type is copied.
+     */
+    template <typename T>
+    struct copy_clone {
+        constexpr copy_clone() noexcept = default;
+
+        template <typename U>
+        constexpr copy_clone(copy_clone <U> const&) noexcept {}
+
+        SUTIL_CONSTEXPR20 T* operator()(T* other) const {
+            return new T(*other);
+        }
+    };
+
+    namespace detail
+    {
+        // frees raw memory on scope exit, unless released. exception safe without try/catch.
+        struct raw_memory_guard
+        {
+            void* mem;
+            std::size_t align;
+
+            void* release() noexcept
+            {
+                void* p = mem;
+                mem = nullptr;
+                return p;
+            }
+
+            ~raw_memory_guard()
+            {
+                if (!mem)
+                    return;
+#if defined(__cpp_aligned_new)
+                if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                {
+                    ::operator delete(mem, std::align_val_t(align));
+                    return;
+                }
+#endif
+                ::operator delete(mem);
+            }
+        };
+
+        inline void* allocate_nothrow(std::size_t size, std::size_t align) noexcept
+        {
+#if defined(__cpp_aligned_new)
+            if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                return ::operator new(size, std::align_val_t(align), std::nothrow);
+#else
+            static_cast <void> (align);
+#endif
+            return ::operator new(size, std::nothrow);
+        }
+    }
+
+    /**
+     *  Clones without throwing on allocation failure, for builds without exceptions.
+     *  Allocation failure is reported as std::errc::not_enough_memory through the error_code overload,
+     *  which value_ptr::try_clone and value_ptr::try_assign use. The single argument overload, used by
+     *  the copy constructor and copy assignment, has no way to report it and calls std::terminate,
+     *  as a throwing new does without exceptions.
+     *
+     *  Polymorphic types must derive from placement_cloneable; they are cloned with clone_into into memory
+     *  from the global operator new, so they must not have a class specific operator new.
+     *  Other types are copy constructed.
+     */
+    template <typename T>
+    struct nothrow_clone {
+        constexpr nothrow_clone() noexcept = default;
+
+        template <typename U>
+        constexpr nothrow_clone(nothrow_clone <U> const&) noexcept {}
+
+        T* operator()(T* other, std::error_code& ec) const {
+            T* result = clone(other, std::is_polymorphic <T> ());
+            if (!result)
+                ec = std::make_error_code(std::errc::not_enough_memory);
+            return result;
+        }
+
+        T* operator()(T* other) const {
+            T* result = clone(other, std::is_polymorphic <T> ());
+            if (!result)
+                std::terminate();
+            return result;
+        }
+
+    private:
+        static T* clone(T* other, std::true_type /* polymorphic */) {
+            detail::raw_memory_guard guard{
+                detail::allocate_nothrow(other->dynamic_size(), other->dynamic_alignment()),
+                other->dynamic_alignment()
+            };
+            if (!guard.mem)
+                return nullptr;
+            T* result = static_cast <T*> (other->clone_into(guard.mem));
+            guard.release();
+            return result;
+        }
+
+        static T* clone(T* other, std::false_type /* polymorphic */) {
+            return new (std::nothrow) T(*other);
+        }
     };
 }
 
@@ -0,0 +1,408 @@
+#ifndef SIMPLE_UTIL_COMPACT_VALUE_PTR_HPP_INCLUDED
+#define SIMPLE_UTIL_COMPACT_VALUE_PTR_HPP_INCLUDED
+
+#include "cloner.hpp"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace sutil
+{
+    template <typename T, typename ClonerT, typename DeleterT>
+    class compact_value_ptr;
+
+    namespace detail
+    {
+        // the part of a policy_table entry that every table shares: which table the entry belongs to.
+        struct policy_entry_base
+        {
+            void const* table;
+        };
+    }
+
+    /**
+     *  Base class for pointees of compact_value_ptr. Holds the interned policies the object is cloned and deleted with.
+     *  Copying or assigning an object does not copy its policies.
+     */
+    class policy_header
+    {
+    protected:
+        policy_header() noexcept = default;
+
+        policy_header(policy_header const&) noexcept
+            : policy_(nullptr)
+        {
+        }
+
+        policy_header& operator=(policy_header const&) noexcept
+        {
+            return *this;
+        }
+
+        ~policy_header() = default;
+
+    private:
+        template <typename T, typename ClonerT, typename DeleterT>
+        friend class compact_value_ptr;
+
+        detail::policy_entry_base const* policy_ = nullptr;
+    };
+
+    /**
+     *  Interns cloner/deleter pairs. Equal pairs share one entry, entries are never destroyed.
+     *  Stateful policies must be equality comparable. Stateless ones share a single entry.
+     */
+    template <typename ClonerT, typename DeleterT>
+    class policy_table
+    {
+    public:
+        struct entry : detail::policy_entry_base
+        {
+            entry(ClonerT const& c, DeleterT const& d)
+                : detail::policy_entry_base{tag()}
+                , cloner(c)
+                , deleter(d)
+            {
+            }
+
+            ClonerT cloner;
+            DeleterT deleter;
+        };
+
+        /**
+         *  Identifies this table. Entries of this table carry it.
+         */
+        static void const* tag() noexcept
+        {
+            return &id;
+        }
+
+        /**
+         *  The entry for {c, d}, created if there is none.
+         */
+        static entry const* intern(ClonerT const& c, DeleterT const& d)
+        {
+            return intern(c, d, std::integral_constant <bool, std::is_empty <ClonerT>::value && std::is_empty <DeleterT>::value> ());
+        }
+
+        /**
+         *  Number of interned entries.
+         */
+        static std::size_t size()
+        {
+            state& s = table();
+            std::lock_guard <std::mutex> lock(s.mutex);
+            return s.entries.size();
+        }
+
+    private:
+        struct state
+        {
+            std::mutex mutex;
+            std::deque <entry> entries;
+        };
+
+        // not const, so that it is never merged with another table's.
+        static char id;
+
+        static state& table()
+        {
+            static state* s = new state();
+            return *s;
+        }
+
+        static entry const* intern(ClonerT const& c, DeleterT const& d, std::true_type /* stateless */)
+        {
+            static entry const* e = intern(c, d, std::false_type());
+            return e;
+        }
+
+        static entry const* intern(ClonerT const& c, DeleterT const& d, std::false_type /* stateless */)
+        {
+            state& s = table();
+            std::lock_guard <std::mutex> lock(s.mutex);
+            for (auto const& e : s.entries)
+            {
+                if (equal(e.cloner, c) && equal(e.deleter, d))
+                    return &e;
+            }
+            s.entries.emplace_back(c, d);
+            return &s.entries.back();
+        }
+
+        template <typename PolicyT>
+        static bool equal(PolicyT const& lhs, PolicyT const& rhs)
+        {
+            return equal(lhs, rhs, std::is_empty <PolicyT> ());
+        }
+
+        template <typename PolicyT>
+        static bool equal(PolicyT const&, PolicyT const&, std::true_type /* empty */)
+        {
+            return true;
+        }
+
+        template <typename PolicyT>
+        static bool equal(PolicyT const& lhs, PolicyT const& rhs, std::false_type /* empty */)
+        {
+            return lhs == rhs;
+        }
+    };
+
+    template <typename ClonerT, typename DeleterT>
+    char policy_table <ClonerT, DeleterT>::id = 0;
+
+    /**
+     *  A value_ptr that is only as big as a raw pointer, even with stateful policies.
+     *  The cloner and deleter are interned in a policy_table and the pointee refers to its entry
+     *  through its policy_header base, so containers of compact_value_ptrs cost as much memory as raw pointers.
+     *  Policies are shared by all objects using them and are called through const references,
+     *  they must therefore be safe to call concurrently.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class compact_value_ptr
+    {
+        static_assert(std::is_base_of <policy_header, T>::value, "the pointee must derive from policy_header");
+
+    public:
+        using pointer = T*;
+        using element_type = T;
+        using deleter_type = DeleterT;
+        using cloner_type = ClonerT;
+        using table_type = policy_table <ClonerT, DeleterT>;
+
+        /**
+         *  Creates an invalid compact_value_ptr that has ownership of nothing.
+         */
+        constexpr compact_value_ptr() noexcept
+            : ptr_(nullptr)
+        {
+        }
+
+        /**
+         *  Creates an invalid compact_value_ptr that has ownership of nothing.
+         */
+        constexpr compact_value_ptr(std::nullptr_t) noexcept
+            : ptr_(nullptr)
+        {
+        }
+
+        /**
+         *  Creates a new compact_value_ptr from a raw owning pointer and aquires ownership.
+         *  ptr keeps its policies if they are from this compact_value_ptr's table (see release()),
+         *  otherwise it gets default constructed ones. Cannot be noexcept, because interning may allocate.
+         *  ptr is not deleted if it throws.
+         *
+         *  @param ptr The pointer to take ownership of.
+         */
+        explicit compact_value_ptr(T* ptr)
+            : ptr_(nullptr)
+        {
+            if (ptr)
+                adopt(ptr);
+            ptr_ = ptr;
+        }
+
+        /**
+         *  Creates a new compact_value_ptr from a raw owning pointer and aquires ownership.
+         *  Also sets a deleter function and a cloner function, which are interned.
+         *  Cannot be noexcept, because interning may allocate. ptr is not deleted if it throws.
+         *
+         *  @param ptr The pointer to take ownership of.
+         *  @param d A deleter.
+         *  @param c A cloner.
+         */
+        compact_value_ptr(T* ptr, deleter_type const& d, cloner_type const& c)
+            : ptr_(ptr)
+        {
+            if (ptr_)
+                attach(ptr_, table_type::intern(c, d));
+        }
+
+        /**
+         *  Copies the pointee with the shared cloner. Cannot be noexcept, because clone may throw.
+         */
+        compact_value_ptr(compact_value_ptr const& v)
+            : ptr_(v.clone())
+        {
+        }
+
+        compact_value_ptr(compact_value_ptr&& v) noexcept
+            : ptr_(v.release())
+        {
+        }
+
+        /**
+         *  "Clone" assignment. Remains unaltered if clone throws.
+         */
+        compact_value_ptr& operator=(compact_value_ptr const& v)
+        {
+            reset(v.clone());
+            return *this;
+        }
+
+        compact_value_ptr& operator=(compact_value_ptr&& v) noexcept
+        {
+            reset(v.release());
+            return *this;
+        }
+
+        /**
+         *  Destructor.
+         */
+        ~compact_value_ptr()
+        {
+            reset();
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        T& operator*() const
+        {
+            return *ptr_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        pointer operator->() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Retrieves the held pointee.
+         */
+        pointer get() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Retrieves the shared deleter.
+         */
+        deleter_type const& get_deleter() const
+        {
+            return policies()->deleter;
+        }
+
+        /**
+         *  Retrieves the shared cloner.
+         */
+        cloner_type const& get_cloner() const
+        {
+            return policies()->cloner;
+        }
+
+        /**
+         *  Resets the compact_value_ptr with a new object. Calls the deleter on the old object.
+         *  p keeps its policies if they are from this compact_value_ptr's table (see release()),
+         *  otherwise it gets default constructed ones. Nothing changes if that throws.
+         */
+        void reset(pointer p = pointer())
+        {
+            if (p == ptr_)
+                return;
+            if (p)
+                adopt(p);
+            pointer old = ptr_;
+            ptr_ = p;
+            if (old)
+                entry_of(old)->deleter(old);
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return ptr_ != nullptr;
+        }
+
+        /**
+         *  Gets the owned object and disengages ownership.
+         *  The object stays attached to its policies, get them with get_deleter() before.
+         *  Handed to a compact_value_ptr with the same cloner and deleter types again, it keeps them.
+         *  Any other compact_value_ptr ignores them and attaches its default policies.
+         */
+        pointer release() noexcept
+        {
+            pointer p = ptr_;
+            ptr_ = nullptr;
+            return p;
+        }
+
+        /**
+         *  Swaps the pointee's.
+         */
+        void swap(compact_value_ptr& v) noexcept
+        {
+            std::swap(ptr_, v.ptr_);
+        }
+
+    private:
+        using entry = typename table_type::entry;
+
+        static policy_header& header(T* p) noexcept
+        {
+            return *p;
+        }
+
+        // the entry of an owned object, which is always from this table.
+        static entry const* entry_of(T* p) noexcept
+        {
+            return static_cast <entry const*> (header(p).policy_);
+        }
+
+        // keeps p's entry if it is from this table, attaches the default one otherwise.
+        static void adopt(T* p)
+        {
+            detail::policy_entry_base const* e = header(p).policy_;
+            if (!e || e->table != table_type::tag())
+                attach(p, default_policies());
+        }
+
+        static void attach(T* p, entry const* e) noexcept
+        {
+            header(p).policy_ = e;
+        }
+
+        static entry const* default_policies()
+        {
+            static entry const* e = table_type::intern(cloner_type(), deleter_type());
+            return e;
+        }
+
+        entry const* policies() const
+        {
+            return ptr_ ? entry_of(ptr_) : default_policies();
+        }
+
+        pointer clone() const
+        {
+            if (!ptr_)
+                return nullptr;
+            entry const* e = entry_of(ptr_);
+            pointer p = e->cloner(ptr_);
+            if (p)
+                attach(p, e);
+            return p;
+        }
+
+    private:
+        T* ptr_;
+    };
+
+    template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
+    compact_value_ptr <T, ClonerT, DeleterT> make_compact_value(List&&... list)
+    {
+        return compact_value_ptr <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_COMPACT_VALUE_PTR_HPP_INCLUDED
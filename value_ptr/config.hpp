@@ -0,0 +1,25 @@
+#ifndef SIMPLE_UTIL_CONFIG_HPP_INCLUDED
+#define SIMPLE_UTIL_CONFIG_HPP_INCLUDED
+
+// constexpr for functions that allocate, free or destroy (C++20 constexpr new/delete and destructors).
+#if defined(__cpp_constexpr_dynamic_alloc) && __cpp_constexpr_dynamic_alloc >= 201907L
+#   define SUTIL_CONSTEXPR20 constexpr
+#else
+#   define SUTIL_CONSTEXPR20
+#endif
+
+// the language standard. msvc keeps __cplusplus at 199711L unless /Zc:__cplusplus is given, _MSVC_LANG has the real one.
+#if defined(_MSVC_LANG) && _MSVC_LANG > __cplusplus
+#   define SUTIL_CPLUSPLUS _MSVC_LANG
+#else
+#   define SUTIL_CPLUSPLUS __cplusplus
+#endif
+
+// 0 when compiled without exceptions (-fno-exceptions, or msvc without /EHsc).
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#   define SUTIL_HAS_EXCEPTIONS 1
+#else
+#   define SUTIL_HAS_EXCEPTIONS 0
+#endif
+
+#endif // SIMPLE_UTIL_CONFIG_HPP_INCLUDED
@@ -0,0 +1,296 @@
+#ifndef SIMPLE_UTIL_COW_PTR_HPP_INCLUDED
+#define SIMPLE_UTIL_COW_PTR_HPP_INCLUDED
+
+#include "cloner.hpp"
+
+#include <atomic>
+#include <type_traits>
+#include <memory>
+#include <tuple>
+
+namespace sutil
+{
+    namespace detail
+    {
+        // the number of cow_ptrs sharing a pointee.
+        struct cow_count
+        {
+            std::atomic <long> uses;
+        };
+    }
+
+    /**
+     *  A cow_ptr behaves like a value_ptr, but copies share the pointee until one of them is modified.
+     *  Read access is const. Write access goes through modify(), which clones the pointee with the cloner
+     *  if it is shared with another cow_ptr or borrowed from storage the cow_ptr does not own.
+     *
+     *  Copies may be used and dropped on other threads. The reference count is read with acquire semantics,
+     *  so once modify() finds the pointee unshared, all reads through dropped copies happened before its writes.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class cow_ptr
+    {
+    public:
+        using pointer = T*;
+        using const_pointer = T const*;
+        using element_type = T;
+        using deleter_type = DeleterT;
+        using cloner_type = ClonerT;
+
+        /**
+         *  Creates an invalid cow_ptr that has ownership of nothing.
+         */
+        constexpr cow_ptr() noexcept
+            : m_(nullptr, cloner_type(), deleter_type())
+            , count_(nullptr)
+        {
+        }
+
+        /**
+         *  Creates an invalid cow_ptr that has ownership of nothing.
+         */
+        constexpr cow_ptr(std::nullptr_t) noexcept
+            : m_(nullptr, cloner_type(), deleter_type())
+            , count_(nullptr)
+        {
+        }
+
+        /**
+         *  Creates a new cow_ptr from a raw owning pointer and aquires ownership.
+         *  Allocates the reference count, ptr is deleted if that throws.
+         *
+         *  @param ptr The pointer to take ownership of.
+         */
+        explicit cow_ptr(T* ptr)
+            : m_(ptr, cloner_type(), deleter_type())
+            , count_(new_count(ptr, get_deleter()))
+        {
+        }
+
+        /**
+         *  Creates a new cow_ptr from a raw owning pointer and aquires ownership.
+         *  Also sets a deleter function and a cloner function.
+         *  Allocates the reference count, ptr is deleted if that throws.
+         *
+         *  @param ptr The pointer to take ownership of.
+         *  @param d A deleter.
+         *  @param c A cloner.
+         */
+        cow_ptr(T* ptr, deleter_type d, cloner_type c)
+            : m_(ptr, std::move(c), std::move(d))
+            , count_(new_count(ptr, get_deleter()))
+        {
+        }
+
+        /**
+         *  Shares the pointee.
+         */
+        cow_ptr(cow_ptr const& v) noexcept
+            : m_(v.m_)
+            , count_(v.count_)
+        {
+            if (count_)
+                count_->uses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        cow_ptr(cow_ptr&& v) noexcept
+            : m_(v.m_)
+            , count_(v.count_)
+        {
+            std::get <0> (v.m_) = nullptr;
+            v.count_ = nullptr;
+        }
+
+        cow_ptr& operator=(cow_ptr const& v) noexcept
+        {
+            cow_ptr(v).swap(*this);
+            return *this;
+        }
+
+        cow_ptr& operator=(cow_ptr&& v) noexcept
+        {
+            cow_ptr(std::move(v)).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Destructor. Deletes the pointee if this was its last owner.
+         */
+        ~cow_ptr()
+        {
+            drop();
+        }
+
+        /**
+         *  Creates a cow_ptr that refers to an object it does not own, for instance a constant
+         *  prototype in static storage. The object is never written to; the first modify() clones it.
+         *
+         *  @param obj An object that outlives the returned cow_ptr and all its copies.
+         */
+        static cow_ptr borrow(T const& obj) noexcept
+        {
+            cow_ptr result;
+            // no reference count, use_count() == 0.
+            std::get <0> (result.m_) = const_cast <T*> (&obj);
+            return result;
+        }
+
+        /**
+         *  Convenient dereferencing operator. Read only.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <element_type>::type>::type operator*() const
+        {
+            return *get();
+        }
+
+        /**
+         *  Convenient arrow operator. Read only.
+         */
+        const_pointer operator->() const
+        {
+            return get();
+        }
+
+        /**
+         *  Retrieves the held pointee for reading.
+         */
+        const_pointer get() const noexcept
+        {
+            return std::get <0> (m_);
+        }
+
+        /**
+         *  Retrieves the held pointee for writing.
+         *  Clones the pointee first, if it is shared or borrowed. Cannot be noexcept, because clone may throw.
+         *  The cow_ptr remains unaltered if clone throws.
+         */
+        pointer modify()
+        {
+            if (is_shared())
+                unshare();
+            return std::get <0> (m_);
+        }
+
+        /**
+         *  Does this cow_ptr have to clone before it may write to the pointee?
+         *  If not, writes after this call happen after everything done through copies that were dropped before it.
+         */
+        bool is_shared() const noexcept
+        {
+            return get() != nullptr && (!count_ || count_->uses.load(std::memory_order_acquire) != 1);
+        }
+
+        /**
+         *  Number of cow_ptrs sharing the pointee. 0 for borrowed or empty pointers.
+         */
+        long use_count() const noexcept
+        {
+            return count_ ? count_->uses.load(std::memory_order_relaxed) : 0;
+        }
+
+        /**
+         *  Retrieves a reference to the deleter.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <deleter_type>::type>::type
+        get_deleter() const noexcept
+        {
+            return std::get <2> (m_);
+        }
+
+        /**
+         *  Retrieves a reference to the cloner.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <cloner_type>::type>::type
+        get_cloner() const noexcept
+        {
+            return std::get <1> (m_);
+        }
+
+        /**
+         *  Resets the cow_ptr with a new object. The old object is deleted if this was its last owner.
+         *  Allocates the reference count, p is deleted if that throws. Does nothing if p is already held.
+         */
+        void reset(pointer p = pointer())
+        {
+            if (p == get())
+                return;
+            detail::cow_count* count = new_count(p, get_deleter());
+            drop();
+            std::get <0> (m_) = p;
+            count_ = count;
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return get() == nullptr ? false : true;
+        }
+
+        /**
+         *  Swaps the pointee's.
+         */
+        void swap(cow_ptr& v) noexcept
+        {
+            using std::swap;
+            swap(m_, v.m_);
+            swap(count_, v.count_);
+        }
+
+    private:
+        // a count of 1 for p. deletes p if the allocation throws.
+        static detail::cow_count* new_count(pointer p, deleter_type const& d)
+        {
+            if (!p)
+                return nullptr;
+            struct guard_type
+            {
+                pointer p;
+                deleter_type const& d;
+
+                ~guard_type()
+                {
+                    if (p)
+                        d(p);
+                }
+            } guard{p, d};
+            detail::cow_count* count = new detail::cow_count{{1}};
+            guard.p = nullptr;
+            return count;
+        }
+
+        // gives up this owner's share.
+        void drop() noexcept
+        {
+            if (count_ && count_->uses.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                delete count_;
+                get_deleter()(std::get <0> (m_));
+            }
+            std::get <0> (m_) = nullptr;
+            count_ = nullptr;
+        }
+
+        void unshare()
+        {
+            pointer copy = get_cloner()(std::get <0> (m_));
+            detail::cow_count* count = new_count(copy, get_deleter());
+            drop();
+            std::get <0> (m_) = copy;
+            count_ = count;
+        }
+
+    private:
+        std::tuple <T*, ClonerT, DeleterT> m_;
+        detail::cow_count* count_;
+    };
+
+    template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
+    cow_ptr <T, ClonerT, DeleterT> make_cow(List&&... list)
+    {
+        return cow_ptr <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_COW_PTR_HPP_INCLUDED
@@ -0,0 +1,133 @@
+#ifndef SIMPLE_UTIL_DESTROY_RANGE_HPP_INCLUDED
+#define SIMPLE_UTIL_DESTROY_RANGE_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace sutil
+{
+    namespace detail
+    {
+        // deleters that only destroy, while the memory belongs to someone else (like arena_delete),
+        // declare static constexpr bool destroys_only = true.
+        template <typename DeleterT, typename = void>
+        struct destroys_only : std::false_type {};
+
+        template <typename DeleterT>
+        struct destroys_only <DeleterT, typename std::enable_if <DeleterT::destroys_only>::type> : std::true_type {};
+
+        // sort key that is equal for objects of the same dynamic type: the address of the vtable,
+        // read from the start of the most derived object (where common ABIs put it). Works without RTTI.
+        // Only the order of destruction depends on it.
+        template <typename T>
+        std::uintptr_t type_key(T* p) noexcept
+        {
+            std::uintptr_t key;
+            std::memcpy(&key, dynamic_cast <void const*> (p), sizeof(key));
+            return key;
+        }
+
+        enum class destroy_mode
+        {
+            // the memory is owned elsewhere and there is nothing to destroy.
+            skip,
+            // one stateless deleter for all, polymorphic pointees are grouped by dynamic type.
+            grouped,
+            // every value_ptr uses its own deleter.
+            each
+        };
+
+        template <typename T, typename DeleterT>
+        struct destroy_mode_for : std::integral_constant <destroy_mode,
+            destroys_only <DeleterT>::value && std::is_trivially_destructible <T>::value ? destroy_mode::skip :
+            std::is_empty <DeleterT>::value && std::is_polymorphic <T>::value ? destroy_mode::grouped :
+            destroy_mode::each>
+        {
+        };
+
+        template <typename ForwardIt>
+        void destroy_range(ForwardIt first, ForwardIt last, std::integral_constant <destroy_mode, destroy_mode::skip>) noexcept
+        {
+            for (; first != last; ++first)
+                first->release();
+        }
+
+        template <typename ForwardIt>
+        void destroy_range(ForwardIt first, ForwardIt last, std::integral_constant <destroy_mode, destroy_mode::grouped>)
+        {
+            using ptr_type = typename std::iterator_traits <ForwardIt>::value_type;
+            using element_type = typename ptr_type::element_type;
+            using deleter_type = typename ptr_type::deleter_type;
+
+            if (first == last)
+                return;
+
+            // allocate before anything is released, so that a throw leaves the range intact.
+            std::vector <std::pair <std::uintptr_t, element_type*> > pointees;
+            pointees.reserve(static_cast <std::size_t> (std::distance(first, last)));
+
+            deleter_type const d = first->get_deleter();
+            for (; first != last; ++first)
+            {
+                element_type* p = first->release();
+                if (p)
+                    pointees.emplace_back(type_key(p), p);
+            }
+
+            // objects of one dynamic type are destroyed one after another.
+            std::sort(pointees.begin(), pointees.end(),
+                [](std::pair <std::uintptr_t, element_type*> const& lhs, std::pair <std::uintptr_t, element_type*> const& rhs) {
+                    return lhs.first < rhs.first;
+                });
+            for (auto const& entry : pointees)
+                d(entry.second);
+        }
+
+        template <typename ForwardIt>
+        void destroy_range(ForwardIt first, ForwardIt last, std::integral_constant <destroy_mode, destroy_mode::each>) noexcept
+        {
+            for (; first != last; ++first)
+                first->reset();
+        }
+    }
+
+    /**
+     *  Destroys the pointees of a range of value_ptrs and leaves the value_ptrs empty.
+     *
+     *  With a stateless deleter, polymorphic pointees are grouped by dynamic type first, so that each destructor
+     *  runs for all objects of its type in a row. Pointees of deleters that only destroy (declaring destroys_only,
+     *  like arena_delete) are skipped entirely if they are trivially destructible. Otherwise the deleters
+     *  are called one by one.
+     *
+     *  May throw std::bad_alloc before anything is destroyed.
+     */
+    template <typename ForwardIt>
+    void destroy_range(ForwardIt first, ForwardIt last)
+    {
+        using ptr_type = typename std::iterator_traits <ForwardIt>::value_type;
+        detail::destroy_range(first, last, detail::destroy_mode_for <typename ptr_type::element_type,
+                                                                     typename ptr_type::deleter_type> ());
+    }
+
+    /**
+     *  Destroys all pointees of a container of value_ptrs with destroy_range, then clears the container.
+     */
+    template <typename ContainerT>
+    void clear_values(ContainerT& container)
+    {
+        destroy_range(std::begin(container), std::end(container));
+        container.clear();
+    }
+}
+
+#endif // SIMPLE_UTIL_DESTROY_RANGE_HPP_INCLUDED
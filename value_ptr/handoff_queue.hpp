@@ -0,0 +1,329 @@
+#ifndef SIMPLE_UTIL_HANDOFF_QUEUE_HPP_INCLUDED
+#define SIMPLE_UTIL_HANDOFF_QUEUE_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace sutil
+{
+    namespace detail
+    {
+        constexpr std::size_t handoff_cache_line = 64;
+
+        inline std::size_t handoff_capacity(std::size_t requested) noexcept
+        {
+            std::size_t capacity = 2;
+            while (capacity < requested)
+                capacity *= 2;
+            return capacity;
+        }
+
+        template <typename ClonerT, typename DeleterT>
+        struct handoff_requirements
+        {
+            static_assert(std::is_empty <ClonerT>::value && std::is_empty <DeleterT>::value,
+                "handoff queues only transfer the pointer, cloner and deleter must be stateless");
+        };
+    }
+
+    /**
+     *  A bounded single producer, single consumer queue of value_ptrs.
+     *  Ownership is handed off by moving the raw pointer into a ring slot, nothing is allocated after construction.
+     *  The producer's and the consumer's indices are on separate cache lines, each side keeps a cached copy
+     *  of the other's index and only reloads it when the queue looks full (or empty).
+     *
+     *  Only one thread may push and only one thread may pop at a time.
+     *  Cloner and deleter must be stateless, they are default constructed on the consumer side.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class spsc_value_queue : detail::handoff_requirements <ClonerT, DeleterT>
+    {
+    public:
+        using value_type = value_ptr <T, ClonerT, DeleterT>;
+
+        /**
+         *  Creates an empty queue.
+         *
+         *  @param capacity The minimum capacity, rounded up to a power of two.
+         */
+        explicit spsc_value_queue(std::size_t capacity)
+            : capacity_(detail::handoff_capacity(capacity))
+            , slots_(new T*[capacity_])
+            , head_()
+            , tail_()
+        {
+        }
+
+        spsc_value_queue(spsc_value_queue const&) = delete;
+        spsc_value_queue& operator=(spsc_value_queue const&) = delete;
+
+        /**
+         *  Destructor. Destroys the values still in the queue.
+         */
+        ~spsc_value_queue()
+        {
+            value_type v;
+            while (try_pop(v))
+                v.reset();
+        }
+
+        /**
+         *  Pushes v, if there is room. v is left unchanged otherwise.
+         */
+        bool try_push(value_type&& v) noexcept
+        {
+            return try_push_batch(&v, 1) == 1;
+        }
+
+        /**
+         *  Pushes as many of the n values at first as fit, in order.
+         *  Publishes them with a single store. Returns the number pushed, those are left empty.
+         */
+        std::size_t try_push_batch(value_type* first, std::size_t n) noexcept
+        {
+            std::size_t const tail = tail_.index.load(std::memory_order_relaxed);
+            std::size_t free = capacity_ - (tail - tail_.cached);
+            if (free < n)
+            {
+                tail_.cached = head_.index.load(std::memory_order_acquire);
+                free = capacity_ - (tail - tail_.cached);
+            }
+            if (n > free)
+                n = free;
+
+            for (std::size_t i = 0; i != n; ++i)
+                slots_[(tail + i) & (capacity_ - 1)] = first[i].release();
+            tail_.index.store(tail + n, std::memory_order_release);
+            return n;
+        }
+
+        /**
+         *  Pops into out, if the queue is not empty.
+         */
+        bool try_pop(value_type& out) noexcept
+        {
+            return try_pop_batch(&out, 1) == 1;
+        }
+
+        /**
+         *  Pops up to n values into out, in order. Returns the number popped.
+         */
+        std::size_t try_pop_batch(value_type* out, std::size_t n) noexcept
+        {
+            std::size_t const head = head_.index.load(std::memory_order_relaxed);
+            std::size_t available = head_.cached - head;
+            if (available < n)
+            {
+                head_.cached = tail_.index.load(std::memory_order_acquire);
+                available = head_.cached - head;
+            }
+            if (n > available)
+                n = available;
+
+            for (std::size_t i = 0; i != n; ++i)
+                out[i].reset(slots_[(head + i) & (capacity_ - 1)]);
+            head_.index.store(head + n, std::memory_order_release);
+            return n;
+        }
+
+        /**
+         *  Number of values in the queue. Only a snapshot while other threads push or pop.
+         */
+        std::size_t size() const noexcept
+        {
+            // head first: it never passes tail, so tail read afterwards is not behind it.
+            std::size_t const head = head_.index.load(std::memory_order_acquire);
+            std::size_t const tail = tail_.index.load(std::memory_order_acquire);
+            std::size_t const n = tail - head;
+            return n < capacity_ ? n : capacity_;
+        }
+
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+    private:
+        // an index, with the last seen value of the other side's index.
+        struct alignas(detail::handoff_cache_line) side
+        {
+            std::atomic <std::size_t> index{0};
+            std::size_t cached = 0;
+        };
+
+    private:
+        std::size_t capacity_;
+        std::unique_ptr <T*[]> slots_;
+        side head_;
+        side tail_;
+    };
+
+    /**
+     *  A bounded multi producer, multi consumer queue of value_ptrs (Vyukov's bounded queue).
+     *  Every slot carries a sequence number that tells producers and consumers whose turn it is,
+     *  so each push or pop costs a single compare-and-swap on the shared index, and a batch costs one for all its slots.
+     *  Ownership is handed off by moving the raw pointer into the slot, nothing is allocated after construction.
+     *
+     *  Cloner and deleter must be stateless, they are default constructed on the consumer side.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class mpmc_value_queue : detail::handoff_requirements <ClonerT, DeleterT>
+    {
+    public:
+        using value_type = value_ptr <T, ClonerT, DeleterT>;
+
+        /**
+         *  Creates an empty queue.
+         *
+         *  @param capacity The minimum capacity, rounded up to a power of two.
+         */
+        explicit mpmc_value_queue(std::size_t capacity)
+            : capacity_(detail::handoff_capacity(capacity))
+            , slots_(new slot[capacity_])
+            , enqueue_()
+            , dequeue_()
+        {
+            for (std::size_t i = 0; i != capacity_; ++i)
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        mpmc_value_queue(mpmc_value_queue const&) = delete;
+        mpmc_value_queue& operator=(mpmc_value_queue const&) = delete;
+
+        /**
+         *  Destructor. Destroys the values still in the queue.
+         */
+        ~mpmc_value_queue()
+        {
+            value_type v;
+            while (try_pop(v))
+                v.reset();
+        }
+
+        /**
+         *  Pushes v, if there is room. v is left unchanged otherwise.
+         */
+        bool try_push(value_type&& v) noexcept
+        {
+            return try_push_batch(&v, 1) == 1;
+        }
+
+        /**
+         *  Pushes as many of the n values at first as there are consecutive free slots.
+         *  The slots are claimed with a single compare-and-swap. Returns the number pushed, those are left empty.
+         */
+        std::size_t try_push_batch(value_type* first, std::size_t n) noexcept
+        {
+            std::size_t pos = enqueue_.index.load(std::memory_order_relaxed);
+            std::size_t claimed;
+            for (;;)
+            {
+                // a slot is free for pos when its sequence equals pos.
+                claimed = 0;
+                while (claimed != n && sequence(pos + claimed) == pos + claimed)
+                    ++claimed;
+                if (claimed != 0)
+                {
+                    if (enqueue_.index.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                        break;
+                    continue;
+                }
+                std::size_t const current = enqueue_.index.load(std::memory_order_relaxed);
+                if (current == pos)
+                    return 0;
+                pos = current;
+            }
+
+            for (std::size_t i = 0; i != claimed; ++i)
+            {
+                slot& s = slots_[(pos + i) & (capacity_ - 1)];
+                s.value = first[i].release();
+                s.sequence.store(pos + i + 1, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        /**
+         *  Pops into out, if the queue is not empty.
+         */
+        bool try_pop(value_type& out) noexcept
+        {
+            return try_pop_batch(&out, 1) == 1;
+        }
+
+        /**
+         *  Pops up to n values into out, as many as there are consecutive filled slots.
+         *  The slots are claimed with a single compare-and-swap. Returns the number popped.
+         */
+        std::size_t try_pop_batch(value_type* out, std::size_t n) noexcept
+        {
+            std::size_t pos = dequeue_.index.load(std::memory_order_relaxed);
+            std::size_t claimed;
+            for (;;)
+            {
+                // a slot is filled for pos when its sequence equals pos + 1.
+                claimed = 0;
+                while (claimed != n && sequence(pos + claimed) == pos + claimed + 1)
+                    ++claimed;
+                if (claimed != 0)
+                {
+                    if (dequeue_.index.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+                        break;
+                    continue;
+                }
+                std::size_t const current = dequeue_.index.load(std::memory_order_relaxed);
+                if (current == pos)
+                    return 0;
+                pos = current;
+            }
+
+            for (std::size_t i = 0; i != claimed; ++i)
+            {
+                slot& s = slots_[(pos + i) & (capacity_ - 1)];
+                out[i].reset(s.value);
+                s.sequence.store(pos + i + capacity_, std::memory_order_release);
+            }
+            return claimed;
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+    private:
+        struct slot
+        {
+            std::atomic <std::size_t> sequence;
+            T* value;
+        };
+
+        struct alignas(detail::handoff_cache_line) padded_index
+        {
+            std::atomic <std::size_t> index{0};
+        };
+
+        std::size_t sequence(std::size_t pos) const noexcept
+        {
+            return slots_[pos & (capacity_ - 1)].sequence.load(std::memory_order_acquire);
+        }
+
+    private:
+        std::size_t capacity_;
+        std::unique_ptr <slot[]> slots_;
+        padded_index enqueue_;
+        padded_index dequeue_;
+    };
+}
+
+#endif // SIMPLE_UTIL_HANDOFF_QUEUE_HPP_INCLUDED
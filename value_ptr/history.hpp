@@ -0,0 +1,180 @@
+#ifndef SIMPLE_UTIL_HISTORY_HPP_INCLUDED
+#define SIMPLE_UTIL_HISTORY_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+
+#include <deque>
+#include <limits>
+#include <cstddef>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  Undo/redo history of a document held in a cow_ptr.
+     *  Each revision is a cow_ptr to the document. If the document's nodes hold their children in
+     *  cow_ptrs too, revisions share all unchanged subtrees with their neighbors.
+     *  Undo and redo only move the current position.
+     *
+     *  Every revision has a cost (1 by default, or e.g. the bytes an edit added). When the total cost of
+     *  the kept revisions exceeds the budget, the oldest revisions are pruned, then those that could be redone.
+     *  The current revision is never pruned.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class history
+    {
+    public:
+        using document_type = cow_ptr <T, ClonerT, DeleterT>;
+
+        /**
+         *  Creates a history with a single revision.
+         *
+         *  @param initial The first revision.
+         *  @param budget The maximum total cost of all kept revisions.
+         */
+        explicit history(document_type initial, std::size_t budget = std::numeric_limits <std::size_t>::max())
+            : revisions_()
+            , current_(0)
+            , budget_(budget)
+            , total_cost_(0)
+        {
+            revisions_.push_back({std::move(initial), 0});
+        }
+
+        /**
+         *  Retrieves the current revision.
+         */
+        document_type const& current() const noexcept
+        {
+            return revisions_[current_].document;
+        }
+
+        /**
+         *  Makes doc the current revision. Discards all revisions that could have been redone.
+         *
+         *  @param doc The new revision, usually a modified copy of current().
+         *  @param cost The cost of the revision, counted against the budget.
+         */
+        void commit(document_type doc, std::size_t cost = 1)
+        {
+            while (revisions_.size() > current_ + 1)
+            {
+                total_cost_ -= revisions_.back().cost;
+                revisions_.pop_back();
+            }
+            revisions_.push_back({std::move(doc), cost});
+            total_cost_ += cost;
+            ++current_;
+            prune();
+        }
+
+        /**
+         *  Copies the current revision, lets editor modify it and commits the result.
+         *  Nothing is committed if editor throws.
+         *
+         *  @param editor Called with a document_type&.
+         *  @param cost The cost of the revision, counted against the budget.
+         */
+        template <typename FunctionT>
+        void edit(FunctionT&& editor, std::size_t cost = 1)
+        {
+            document_type doc = current();
+            editor(doc);
+            commit(std::move(doc), cost);
+        }
+
+        /**
+         *  Steps back one revision. Returns false if there is none.
+         */
+        bool undo() noexcept
+        {
+            if (!can_undo())
+                return false;
+            --current_;
+            return true;
+        }
+
+        /**
+         *  Steps forward one revision. Returns false if there is none.
+         */
+        bool redo() noexcept
+        {
+            if (!can_redo())
+                return false;
+            ++current_;
+            return true;
+        }
+
+        bool can_undo() const noexcept
+        {
+            return current_ > 0;
+        }
+
+        bool can_redo() const noexcept
+        {
+            return current_ + 1 < revisions_.size();
+        }
+
+        /**
+         *  Number of kept revisions, including the current one.
+         */
+        std::size_t size() const noexcept
+        {
+            return revisions_.size();
+        }
+
+        /**
+         *  Total cost of the kept revisions.
+         */
+        std::size_t total_cost() const noexcept
+        {
+            return total_cost_;
+        }
+
+        /**
+         *  Changes the budget. Prunes if necessary.
+         */
+        void set_budget(std::size_t budget)
+        {
+            budget_ = budget;
+            prune();
+        }
+
+        std::size_t budget() const noexcept
+        {
+            return budget_;
+        }
+
+    private:
+        struct revision
+        {
+            document_type document;
+            std::size_t cost;
+        };
+
+        void prune()
+        {
+            while (total_cost_ > budget_ && current_ > 0)
+            {
+                revisions_.pop_front();
+                // the first revision's cost no longer counts, it has nothing to undo to.
+                total_cost_ -= revisions_.front().cost;
+                revisions_.front().cost = 0;
+                --current_;
+            }
+            while (total_cost_ > budget_ && can_redo())
+            {
+                total_cost_ -= revisions_.back().cost;
+                revisions_.pop_back();
+            }
+        }
+
+    private:
+        std::deque <revision> revisions_;
+        std::size_t current_;
+        std::size_t budget_;
+        std::size_t total_cost_;
+    };
+}
+
+#endif // SIMPLE_UTIL_HISTORY_HPP_INCLUDED
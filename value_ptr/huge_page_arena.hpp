@@ -0,0 +1,422 @@
+#ifndef SIMPLE_UTIL_HUGE_PAGE_ARENA_HPP_INCLUDED
+#define SIMPLE_UTIL_HUGE_PAGE_ARENA_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+#include "config.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <system_error>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+#if defined(__linux__)
+#   include <cstdio>
+#   include <cstring>
+#   include <sys/mman.h>
+#endif
+
+namespace sutil
+{
+    /**
+     *  A bump allocator over large regions backed by huge pages where possible, to cut TLB misses
+     *  when traversing big object graphs.
+     *
+     *  Each region is first requested with MAP_HUGETLB (explicit huge pages, which must be reserved by the system).
+     *  If none are available, the region is aligned to the huge page size and advised with MADV_HUGEPAGE,
+     *  so transparent huge pages can back it. Otherwise regular pages are used.
+     *  On systems without mmap, regions come from the global operator new.
+     *
+     *  Allocation failure is reported through an error_code, or with std::bad_alloc by the overloads without one.
+     *  Without exceptions, those call std::abort instead.
+     *
+     *  Memory is only released when the arena is destroyed, all objects must be destroyed before.
+     *  The arena is not synchronized.
+     */
+    class huge_page_arena
+    {
+    public:
+        /**
+         *  The transparent huge page size of the system, read once from
+         *  /sys/kernel/mm/transparent_hugepage/hpage_pmd_size. 2 MiB if that is not available.
+         */
+        static std::size_t huge_page_size() noexcept
+        {
+            static std::size_t const size = detect_huge_page_size();
+            return size;
+        }
+
+        /**
+         *  How a region is backed.
+         */
+        enum class backing
+        {
+            explicit_huge_pages,
+            transparent_huge_pages,
+            regular_pages
+        };
+
+        /**
+         *  Creates an arena without reserving memory.
+         *
+         *  @param region_size The size of the regions to reserve, rounded up to huge_page_size().
+         *                     0 for 32 huge pages.
+         */
+        explicit huge_page_arena(std::size_t region_size = 0) noexcept
+            : page_size_(huge_page_size())
+            , region_size_(round_up(region_size ? region_size : 32 * page_size_, page_size_))
+            , regions_(nullptr)
+            , cursor_(nullptr)
+            , end_(nullptr)
+            , used_(0)
+        {
+        }
+
+        huge_page_arena(huge_page_arena const&) = delete;
+        huge_page_arena& operator=(huge_page_arena const&) = delete;
+
+        /**
+         *  Destructor. Releases all regions.
+         */
+        ~huge_page_arena()
+        {
+            while (region* r = regions_)
+            {
+                regions_ = r->next;
+                release(r);
+            }
+        }
+
+        /**
+         *  Allocates size bytes aligned to align. Throws std::bad_alloc if no region can be reserved.
+         */
+        void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+        {
+            std::error_code ec;
+            void* p = allocate(size, align, ec);
+            if (!p)
+            {
+#if SUTIL_HAS_EXCEPTIONS
+                throw std::bad_alloc();
+#else
+                std::abort();
+#endif
+            }
+            return p;
+        }
+
+        /**
+         *  Allocates size bytes aligned to align.
+         *  Returns nullptr and sets ec to std::errc::not_enough_memory if no region can be reserved.
+         */
+        void* allocate(std::size_t size, std::size_t align, std::error_code& ec) noexcept
+        {
+            std::uintptr_t p = round_up(reinterpret_cast <std::uintptr_t> (cursor_), align);
+            if (!cursor_ || p + size > reinterpret_cast <std::uintptr_t> (end_))
+            {
+                if (!reserve(size + align))
+                {
+                    ec = std::make_error_code(std::errc::not_enough_memory);
+                    return nullptr;
+                }
+                p = round_up(reinterpret_cast <std::uintptr_t> (cursor_), align);
+            }
+            cursor_ = reinterpret_cast <unsigned char*> (p + size);
+            used_ += size;
+            return reinterpret_cast <void*> (p);
+        }
+
+        /**
+         *  Does nothing, memory is released with the arena.
+         */
+        void deallocate(void*, std::size_t) noexcept
+        {
+        }
+
+        /**
+         *  Number of huge pages the arena got, explicit and transparent.
+         */
+        std::size_t huge_pages() const
+        {
+            return explicit_huge_pages() + transparent_huge_pages();
+        }
+
+        /**
+         *  Number of huge pages the arena got through MAP_HUGETLB.
+         */
+        std::size_t explicit_huge_pages() const noexcept
+        {
+            std::size_t bytes = 0;
+            for (region const* r = regions_; r; r = r->next)
+            {
+                if (r->kind == backing::explicit_huge_pages)
+                    bytes += r->size;
+            }
+            return bytes / page_size_;
+        }
+
+        /**
+         *  Number of transparent huge pages currently backing the arena's advised regions,
+         *  as reported by the kernel in /proc/self/smaps (AnonHugePages). Pages are only backed once touched.
+         */
+        std::size_t transparent_huge_pages() const
+        {
+#if defined(__linux__)
+            bool advised = false;
+            for (region const* r = regions_; r; r = r->next)
+                advised = advised || r->kind == backing::transparent_huge_pages;
+            if (!advised)
+                return 0;
+
+            std::FILE* smaps = std::fopen("/proc/self/smaps", "r");
+            if (!smaps)
+                return 0;
+
+            std::size_t kilobytes = 0;
+            bool inside = false;
+            char line[256];
+            while (std::fgets(line, sizeof(line), smaps))
+            {
+                unsigned long long begin, end, size;
+                if (std::sscanf(line, "%llx-%llx ", &begin, &end) == 2)
+                    inside = overlaps_advised(static_cast <std::uintptr_t> (begin), static_cast <std::uintptr_t> (end));
+                else if (inside && std::sscanf(line, "AnonHugePages: %llu kB", &size) == 1)
+                    kilobytes += static_cast <std::size_t> (size);
+            }
+            std::fclose(smaps);
+            return kilobytes * 1024 / page_size_;
+#else
+            return 0;
+#endif
+        }
+
+        /**
+         *  Bytes handed out by allocate.
+         */
+        std::size_t bytes_used() const noexcept
+        {
+            return used_;
+        }
+
+        /**
+         *  Bytes reserved in regions.
+         */
+        std::size_t bytes_reserved() const noexcept
+        {
+            std::size_t bytes = 0;
+            for (region const* r = regions_; r; r = r->next)
+                bytes += r->size;
+            return bytes;
+        }
+
+    private:
+        // lives at the start of its region. the regions form a list, so that adding one cannot fail.
+        struct region
+        {
+            std::size_t size;
+            backing kind;
+            region* next;
+        };
+
+        static std::size_t round_up(std::size_t n, std::size_t multiple) noexcept
+        {
+            return (n + multiple - 1) / multiple * multiple;
+        }
+
+        static std::size_t detect_huge_page_size() noexcept
+        {
+            std::size_t size = 2 * 1024 * 1024;
+#if defined(__linux__)
+            if (std::FILE* f = std::fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r"))
+            {
+                unsigned long long bytes;
+                // must be a power of two, the arena aligns to it.
+                if (std::fscanf(f, "%llu", &bytes) == 1 && bytes != 0 && (bytes & (bytes - 1)) == 0)
+                    size = static_cast <std::size_t> (bytes);
+                std::fclose(f);
+            }
+#endif
+            return size;
+        }
+
+        // false if no region can be reserved.
+        bool reserve(std::size_t at_least) noexcept
+        {
+            at_least += sizeof(region);
+            std::size_t size = at_least > region_size_ ? round_up(at_least, page_size_) : region_size_;
+            region* r = map(size, page_size_);
+            if (!r)
+                return false;
+            r->next = regions_;
+            regions_ = r;
+            cursor_ = reinterpret_cast <unsigned char*> (r) + sizeof(region);
+            end_ = reinterpret_cast <unsigned char*> (r) + r->size;
+            return true;
+        }
+
+#if defined(__linux__)
+        static region* map(std::size_t size, std::size_t page_size) noexcept
+        {
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+                return ::new (p) region{size, backing::explicit_huge_pages, nullptr};
+
+            // over-reserve, so the region can be trimmed to huge page alignment.
+            std::size_t const padded = size + page_size;
+            p = ::mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return nullptr;
+
+            std::uintptr_t const raw = reinterpret_cast <std::uintptr_t> (p);
+            std::uintptr_t const aligned = round_up(raw, page_size);
+            if (aligned != raw)
+                ::munmap(p, aligned - raw);
+            if (raw + padded != aligned + size)
+                ::munmap(reinterpret_cast <void*> (aligned + size), raw + padded - aligned - size);
+
+            void* base = reinterpret_cast <void*> (aligned);
+            backing kind = backing::regular_pages;
+#   if defined(MADV_HUGEPAGE)
+            if (::madvise(base, size, MADV_HUGEPAGE) == 0)
+                kind = backing::transparent_huge_pages;
+#   endif
+            return ::new (base) region{size, kind, nullptr};
+        }
+
+        static void release(region* r) noexcept
+        {
+            ::munmap(r, r->size);
+        }
+
+        bool overlaps_advised(std::uintptr_t begin, std::uintptr_t end) const noexcept
+        {
+            for (region const* r = regions_; r; r = r->next)
+            {
+                std::uintptr_t const base = reinterpret_cast <std::uintptr_t> (r);
+                if (r->kind == backing::transparent_huge_pages && begin < base + r->size && base < end)
+                    return true;
+            }
+            return false;
+        }
+#else
+        static region* map(std::size_t size, std::size_t) noexcept
+        {
+            void* p = ::operator new(size, std::nothrow);
+            return p ? ::new (p) region{size, backing::regular_pages, nullptr} : nullptr;
+        }
+
+        static void release(region* r) noexcept
+        {
+            ::operator delete(r);
+        }
+#endif
+
+    private:
+        std::size_t page_size_;
+        std::size_t region_size_;
+        region* regions_;
+        unsigned char* cursor_;
+        unsigned char* end_;
+        std::size_t used_;
+    };
+
+    /**
+     *  Clones into a huge_page_arena. Polymorphic types must be placement_cloneable, others are copy constructed.
+     *  Like nothrow_clone, it can report allocation failure through an error_code instead of throwing.
+     */
+    template <typename T>
+    struct arena_clone {
+        /**
+         *  Without an arena, for empty value_ptrs only. Cloning with it is a precondition violation.
+         */
+        constexpr arena_clone() noexcept = default;
+
+        constexpr explicit arena_clone(huge_page_arena* arena) noexcept
+            : arena(arena)
+        {
+        }
+
+        template <typename U>
+        constexpr arena_clone(arena_clone <U> const& other) noexcept
+            : arena(other.arena)
+        {
+        }
+
+        T* operator()(T* other) const {
+            assert(arena && "arena_clone without an arena");
+            void* mem = arena->allocate(size_of(other, std::is_polymorphic <T> ()), align_of(other, std::is_polymorphic <T> ()));
+            return clone(other, mem, std::is_polymorphic <T> ());
+        }
+
+        T* operator()(T* other, std::error_code& ec) const {
+            assert(arena && "arena_clone without an arena");
+            void* mem = arena->allocate(size_of(other, std::is_polymorphic <T> ()), align_of(other, std::is_polymorphic <T> ()), ec);
+            return mem ? clone(other, mem, std::is_polymorphic <T> ()) : nullptr;
+        }
+
+        huge_page_arena* arena = nullptr;
+
+    private:
+        static std::size_t size_of(T* other, std::true_type /* polymorphic */) noexcept {
+            return other->dynamic_size();
+        }
+
+        static std::size_t size_of(T*, std::false_type /* polymorphic */) noexcept {
+            return sizeof(T);
+        }
+
+        static std::size_t align_of(T* other, std::true_type /* polymorphic */) noexcept {
+            return other->dynamic_alignment();
+        }
+
+        static std::size_t align_of(T*, std::false_type /* polymorphic */) noexcept {
+            return alignof(T);
+        }
+
+        // a failed clone leaves its bytes in the arena, until it is destroyed.
+        static T* clone(T* other, void* mem, std::true_type /* polymorphic */) {
+            return static_cast <T*> (other->clone_into(mem));
+        }
+
+        static T* clone(T* other, void* mem, std::false_type /* polymorphic */) {
+            return ::new (mem) T(*other);
+        }
+    };
+
+    /**
+     *  Destroys objects in a huge_page_arena. The memory is released with the arena.
+     */
+    template <typename T>
+    struct arena_delete {
+        // the memory belongs to the arena, see destroy_range.
+        static constexpr bool destroys_only = true;
+
+        constexpr arena_delete() noexcept = default;
+
+        template <typename U>
+        constexpr arena_delete(arena_delete <U> const&) noexcept {}
+
+        void operator()(T* p) const noexcept {
+            if (p)
+                p->~T();
+        }
+    };
+
+    template <typename T>
+    using arena_value_ptr = value_ptr <T, arena_clone <T>, arena_delete <T> >;
+
+    /**
+     *  Creates a T in arena. Its clones are placed in the same arena.
+     */
+    template <typename T, typename... List>
+    arena_value_ptr <T> make_arena_value(huge_page_arena& arena, List&&... list)
+    {
+        T* result = ::new (arena.allocate(sizeof(T), alignof(T))) T(std::forward <List> (list)...);
+        return arena_value_ptr <T> (result, arena_delete <T> (), arena_clone <T> (&arena));
+    }
+}
+
+#endif // SIMPLE_UTIL_HUGE_PAGE_ARENA_HPP_INCLUDED
@@ -0,0 +1,287 @@
+#ifndef SIMPLE_UTIL_INPLACE_POLY_HPP_INCLUDED
+#define SIMPLE_UTIL_INPLACE_POLY_HPP_INCLUDED
+
+#include <type_traits>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+namespace sutil
+{
+    namespace detail
+    {
+        template <typename BaseT>
+        struct inplace_poly_vtable
+        {
+            BaseT* (*copy)(void const* from, void* to);
+            BaseT* (*relocate)(void* from, void* to) noexcept;
+            void (*destroy)(void* where) noexcept;
+        };
+
+        template <typename BaseT, typename DerivedT>
+        struct inplace_poly_ops
+        {
+            static BaseT* copy(void const* from, void* to)
+            {
+                return ::new (to) DerivedT(*static_cast <DerivedT const*> (from));
+            }
+
+            static BaseT* relocate(void* from, void* to) noexcept
+            {
+                BaseT* result = ::new (to) DerivedT(std::move(*static_cast <DerivedT*> (from)));
+                static_cast <DerivedT*> (from)->~DerivedT();
+                return result;
+            }
+
+            static void destroy(void* where) noexcept
+            {
+                static_cast <DerivedT*> (where)->~DerivedT();
+            }
+
+            static constexpr inplace_poly_vtable <BaseT> table = {
+                &copy, &relocate, &destroy
+            };
+        };
+
+        template <typename BaseT, typename DerivedT>
+        constexpr inplace_poly_vtable <BaseT> inplace_poly_ops <BaseT, DerivedT>::table;
+    }
+
+    /**
+     *  Holds an object of any type derived from BaseT (or BaseT itself) inline, with value semantics.
+     *  Whether a type fits into MaxSize bytes with alignment Align is checked at compile time,
+     *  there is no fallback to the heap. Copies and moves go through a function table shared per type.
+     *  Stored types must be copy constructible and nothrow move constructible.
+     */
+    template <typename BaseT, std::size_t MaxSize, std::size_t Align = alignof(std::max_align_t)>
+    class inplace_poly
+    {
+    public:
+        using pointer = BaseT*;
+        using element_type = BaseT;
+
+        static constexpr std::size_t max_size = MaxSize;
+        static constexpr std::size_t alignment = Align;
+
+        /**
+         *  Checks whether DerivedT can be stored.
+         */
+        template <typename DerivedT>
+        struct fits
+            : std::integral_constant <bool,
+                sizeof(DerivedT) <= MaxSize &&
+                Align % alignof(DerivedT) == 0>
+        {
+        };
+
+    private:
+        // the converting constructor takes types that emplace accepts.
+        template <typename DerivedT>
+        using accepts = typename std::enable_if <std::is_base_of <BaseT, DerivedT>::value && fits <DerivedT>::value>::type;
+
+    public:
+        /**
+         *  Creates an empty inplace_poly.
+         */
+        constexpr inplace_poly() noexcept
+            : vtable_(nullptr)
+            , ptr_(nullptr)
+            , storage_()
+        {
+        }
+
+        /**
+         *  Creates an empty inplace_poly.
+         */
+        constexpr inplace_poly(std::nullptr_t) noexcept
+            : inplace_poly()
+        {
+        }
+
+        /**
+         *  Stores a copy of (or moves) value. Only takes types derived from BaseT (or BaseT itself) that fit.
+         */
+        template <typename DerivedT, typename = accepts <typename std::decay <DerivedT>::type> >
+        inplace_poly(DerivedT&& value)
+            : vtable_(nullptr)
+            , ptr_(nullptr)
+        {
+            emplace <typename std::decay <DerivedT>::type> (std::forward <DerivedT> (value));
+        }
+
+        /**
+         *  Copies the held object. Not noexcept, because the copy constructor may throw.
+         */
+        inplace_poly(inplace_poly const& other)
+            : vtable_(nullptr)
+            , ptr_(nullptr)
+        {
+            if (other.vtable_)
+            {
+                ptr_ = other.vtable_->copy(other.storage_, storage_);
+                vtable_ = other.vtable_;
+            }
+        }
+
+        /**
+         *  Moves the held object over, other is empty afterwards.
+         */
+        inplace_poly(inplace_poly&& other) noexcept
+            : vtable_(nullptr)
+            , ptr_(nullptr)
+        {
+            take(other);
+        }
+
+        /**
+         *  Copy assignment.
+         */
+        inplace_poly& operator=(inplace_poly const& other)
+        {
+            if (this != &other)
+            {
+                reset();
+                if (other.vtable_)
+                {
+                    ptr_ = other.vtable_->copy(other.storage_, storage_);
+                    vtable_ = other.vtable_;
+                }
+            }
+            return *this;
+        }
+
+        /**
+         *  Move assignment.
+         */
+        inplace_poly& operator=(inplace_poly&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        /**
+         *  Destroys the held object and constructs a DerivedT in its place.
+         */
+        template <typename DerivedT, typename... List>
+        DerivedT& emplace(List&&... list)
+        {
+            static_assert(std::is_base_of <BaseT, DerivedT>::value,
+                "type stored in inplace_poly must be derived from its base");
+            static_assert(sizeof(DerivedT) <= MaxSize,
+                "type does not fit into the inplace_poly");
+            static_assert(Align % alignof(DerivedT) == 0,
+                "type is over-aligned for the inplace_poly");
+            static_assert(std::is_nothrow_move_constructible <DerivedT>::value,
+                "type stored in inplace_poly must be nothrow move constructible");
+
+            reset();
+            DerivedT* p = ::new (static_cast <void*> (storage_)) DerivedT(std::forward <List> (list)...);
+            ptr_ = p;
+            vtable_ = &detail::inplace_poly_ops <BaseT, DerivedT>::table;
+            return *p;
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        typename std::add_lvalue_reference <element_type>::type operator*() const noexcept
+        {
+            return *ptr_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        pointer operator->() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Retrieves the held object.
+         */
+        pointer get() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return ptr_ != nullptr;
+        }
+
+        /**
+         *  Destroys the held object.
+         */
+        void reset() noexcept
+        {
+            if (vtable_)
+            {
+                vtable_->destroy(storage_);
+                vtable_ = nullptr;
+                ptr_ = nullptr;
+            }
+        }
+
+        /**
+         *  Swaps the held objects.
+         */
+        void swap(inplace_poly& other) noexcept
+        {
+            if (this == &other)
+                return;
+            inplace_poly temp(std::move(other));
+            other.take(*this);
+            take(temp);
+        }
+
+        /**
+         *  Destructor.
+         */
+        ~inplace_poly()
+        {
+            reset();
+        }
+
+    private:
+        // requires *this to be empty.
+        void take(inplace_poly& other) noexcept
+        {
+            if (other.vtable_)
+            {
+                ptr_ = other.vtable_->relocate(other.storage_, storage_);
+                vtable_ = other.vtable_;
+                other.vtable_ = nullptr;
+                other.ptr_ = nullptr;
+            }
+        }
+
+    private:
+        detail::inplace_poly_vtable <BaseT> const* vtable_;
+        BaseT* ptr_;
+        alignas(Align) unsigned char storage_[MaxSize];
+    };
+
+    template <typename BaseT, std::size_t MaxSize, std::size_t Align>
+    constexpr std::size_t inplace_poly <BaseT, MaxSize, Align>::max_size;
+
+    template <typename BaseT, std::size_t MaxSize, std::size_t Align>
+    constexpr std::size_t inplace_poly <BaseT, MaxSize, Align>::alignment;
+
+    template <typename BaseT, std::size_t MaxSize, typename DerivedT, typename... List>
+    inplace_poly <BaseT, MaxSize> make_inplace(List&&... list)
+    {
+        inplace_poly <BaseT, MaxSize> result;
+        result.template emplace <DerivedT> (std::forward <List> (list)...);
+        return result;
+    }
+}
+
+#endif // SIMPLE_UTIL_INPLACE_POLY_HPP_INCLUDED
@@ -0,0 +1,220 @@
+#ifndef SIMPLE_UTIL_INTRUSIVE_COW_PTR_HPP_INCLUDED
+#define SIMPLE_UTIL_INTRUSIVE_COW_PTR_HPP_INCLUDED
+
+#include "cloner.hpp"
+
+#include <type_traits>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  A copy-on-write pointer like cow_ptr, for pointees that count their own references (see shared_cloneable).
+     *  Sharing needs no control block: a shared value is a single allocation, and with stateless policies
+     *  the intrusive_cow_ptr is as big as a raw pointer.
+     *
+     *  Read access is const. Write access goes through modify(), which clones the pointee with the cloner
+     *  if it is shared. A clone starts with a reference count of 1.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class intrusive_cow_ptr
+    {
+    public:
+        using pointer = T*;
+        using const_pointer = T const*;
+        using element_type = T;
+        using deleter_type = DeleterT;
+        using cloner_type = ClonerT;
+
+        /**
+         *  Creates an invalid intrusive_cow_ptr that has ownership of nothing.
+         */
+        constexpr intrusive_cow_ptr() noexcept
+            : m_(nullptr, cloner_type(), deleter_type())
+        {
+        }
+
+        /**
+         *  Creates an invalid intrusive_cow_ptr that has ownership of nothing.
+         */
+        constexpr intrusive_cow_ptr(std::nullptr_t) noexcept
+            : m_(nullptr, cloner_type(), deleter_type())
+        {
+        }
+
+        /**
+         *  Creates a new intrusive_cow_ptr from a raw owning pointer and takes over the reference the caller holds,
+         *  the one a newly created object starts with.
+         *
+         *  @param ptr The pointer to take ownership of.
+         */
+        explicit intrusive_cow_ptr(T* ptr) noexcept
+            : m_(ptr, cloner_type(), deleter_type())
+        {
+        }
+
+        /**
+         *  Creates a new intrusive_cow_ptr from a raw owning pointer and takes over the reference the caller holds.
+         *  Also sets a deleter function and a cloner function.
+         *
+         *  @param ptr The pointer to take ownership of.
+         *  @param d A deleter.
+         *  @param c A cloner.
+         */
+        intrusive_cow_ptr(T* ptr, deleter_type d, cloner_type c) noexcept
+            : m_(ptr, std::move(c), std::move(d))
+        {
+        }
+
+        /**
+         *  Shares the pointee.
+         */
+        intrusive_cow_ptr(intrusive_cow_ptr const& v) noexcept
+            : m_(v.m_)
+        {
+            if (get())
+                get()->add_ref();
+        }
+
+        intrusive_cow_ptr(intrusive_cow_ptr&& v) noexcept
+            : m_(v.m_)
+        {
+            std::get <0> (v.m_) = nullptr;
+        }
+
+        intrusive_cow_ptr& operator=(intrusive_cow_ptr const& v) noexcept
+        {
+            intrusive_cow_ptr(v).swap(*this);
+            return *this;
+        }
+
+        intrusive_cow_ptr& operator=(intrusive_cow_ptr&& v) noexcept
+        {
+            intrusive_cow_ptr(std::move(v)).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Destructor. Deletes the pointee if this was its last owner.
+         */
+        ~intrusive_cow_ptr()
+        {
+            reset();
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <element_type>::type>::type operator*() const
+        {
+            return *get();
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        const_pointer operator->() const
+        {
+            return get();
+        }
+
+        /**
+         *  Retrieves the held pointee for reading.
+         */
+        const_pointer get() const noexcept
+        {
+            return std::get <0> (m_);
+        }
+
+        /**
+         *  Retrieves the held pointee for writing.
+         *  Clones the pointee first, if it is shared. Cannot be noexcept, because clone may throw.
+         *  The intrusive_cow_ptr remains unaltered if clone throws.
+         */
+        pointer modify()
+        {
+            if (is_shared())
+            {
+                pointer copy = get_cloner()(std::get <0> (m_));
+                reset(copy);
+            }
+            return std::get <0> (m_);
+        }
+
+        /**
+         *  Does this intrusive_cow_ptr have to clone before it may write to the pointee?
+         */
+        bool is_shared() const noexcept
+        {
+            return get() != nullptr && get()->use_count() != 1;
+        }
+
+        /**
+         *  Number of intrusive_cow_ptrs sharing the pointee. 0 for empty pointers.
+         */
+        long use_count() const noexcept
+        {
+            return get() ? get()->use_count() : 0;
+        }
+
+        /**
+         *  Retrieves a reference to the deleter.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <deleter_type>::type>::type
+        get_deleter() const noexcept
+        {
+            return std::get <2> (m_);
+        }
+
+        /**
+         *  Retrieves a reference to the cloner.
+         */
+        typename std::add_lvalue_reference <typename std::add_const <cloner_type>::type>::type
+        get_cloner() const noexcept
+        {
+            return std::get <1> (m_);
+        }
+
+        /**
+         *  Resets the intrusive_cow_ptr with a new object, taking over the caller's reference.
+         *  The old object is deleted if this was its last owner.
+         */
+        void reset(pointer p = pointer()) noexcept
+        {
+            pointer old = std::get <0> (m_);
+            std::get <0> (m_) = p;
+            if (old && old->release_ref())
+                std::get <2> (m_)(old);
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return get() == nullptr ? false : true;
+        }
+
+        /**
+         *  Swaps the pointee's.
+         */
+        void swap(intrusive_cow_ptr& v) noexcept
+        {
+            using std::swap;
+            swap(m_, v.m_);
+        }
+
+    private:
+        std::tuple <T*, ClonerT, DeleterT> m_;
+    };
+
+    template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
+    intrusive_cow_ptr <T, ClonerT, DeleterT> make_intrusive_cow(List&&... list)
+    {
+        return intrusive_cow_ptr <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_INTRUSIVE_COW_PTR_HPP_INCLUDED
@@ -0,0 +1,116 @@
+#ifndef SIMPLE_UTIL_LOCAL_CLONE_HPP_INCLUDED
+#define SIMPLE_UTIL_LOCAL_CLONE_HPP_INCLUDED
+
+#include "cloneable.hpp"
+#include "config.hpp"
+
+#include <type_traits>
+#include <cstddef>
+
+namespace sutil
+{
+    /**
+     *  A scoped, mutable copy of a polymorphic object.
+     *  The copy is placed into a buffer of N bytes inside the holder (usually on the stack),
+     *  if the dynamic type fits. Otherwise it is cloned onto the heap. Either way it is destroyed with the holder.
+     *
+     *  BaseT must derive from placement_cloneable. The holder can neither be copied nor moved,
+     *  because the dynamic type cannot be relocated.
+     */
+    template <typename BaseT, std::size_t N>
+    class local_clone_holder
+    {
+        static_assert(N > 0, "the local buffer needs at least one byte, zero-length arrays are ill-formed");
+
+    public:
+        using pointer = BaseT*;
+        using element_type = BaseT;
+
+        static constexpr std::size_t buffer_size = N;
+
+        /**
+         *  Clones obj. Cannot be noexcept, because clone may throw.
+         */
+        explicit local_clone_holder(BaseT const& obj)
+            : ptr_(nullptr)
+            , local_(obj.dynamic_size() <= N && obj.dynamic_alignment() <= alignof(std::max_align_t))
+        {
+            if (local_)
+                ptr_ = static_cast <BaseT*> (obj.clone_into(buffer_));
+            else
+                ptr_ = static_cast <BaseT*> (obj.clone());
+        }
+
+        local_clone_holder(local_clone_holder const&) = delete;
+        local_clone_holder& operator=(local_clone_holder const&) = delete;
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        typename std::add_lvalue_reference <element_type>::type operator*() const noexcept
+        {
+            return *ptr_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        pointer operator->() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Retrieves the copy.
+         */
+        pointer get() const noexcept
+        {
+            return ptr_;
+        }
+
+        /**
+         *  Is the copy in the local buffer (true) or on the heap (false)?
+         */
+        bool is_local() const noexcept
+        {
+            return local_;
+        }
+
+        /**
+         *  Destroys the copy.
+         */
+        ~local_clone_holder()
+        {
+            if (local_)
+                ptr_->~BaseT();
+            else
+                delete ptr_;
+        }
+
+    private:
+        BaseT* ptr_;
+        bool local_;
+        alignas(std::max_align_t) unsigned char buffer_[N];
+    };
+
+    template <typename BaseT, std::size_t N>
+    constexpr std::size_t local_clone_holder <BaseT, N>::buffer_size;
+
+#if SUTIL_CPLUSPLUS >= 201703L
+    /**
+     *  Makes a scoped copy of obj, in a local buffer of N bytes if the dynamic type fits:
+     *
+     *      auto copy = sutil::local_clone <256> (*ptr);
+     *      copy->apply(what_if);
+     *
+     *  Relies on guaranteed copy elision (C++17). Before, declare a local_clone_holder directly.
+     */
+    template <std::size_t N, typename BaseT>
+    local_clone_holder <BaseT, N> local_clone(BaseT const& obj)
+    {
+        return local_clone_holder <BaseT, N> (obj);
+    }
+#endif
+}
+
+#endif // SIMPLE_UTIL_LOCAL_CLONE_HPP_INCLUDED
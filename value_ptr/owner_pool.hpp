@@ -0,0 +1,296 @@
+#ifndef SIMPLE_UTIL_OWNER_POOL_HPP_INCLUDED
+#define SIMPLE_UTIL_OWNER_POOL_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  A memory pool for blocks of BlockSize bytes that returns every block to the thread that allocated it.
+     *  Made for producer/consumer pipelines, where objects are created on one thread and destroyed on another.
+     *
+     *  Every thread allocates from its own pool without synchronization. Each block has a small header
+     *  naming its pool, written once when the block is carved. A block freed on its owner thread goes straight back
+     *  to the local freelist. A block freed on another thread is collected in a per-thread batch, and the batch is
+     *  pushed onto the owner's lock-free remote-free list with a single compare-and-swap when it is full,
+     *  when a block of another owner is freed, or when the thread exits.
+     *  The owner takes the whole remote-free list in one exchange when its local freelist runs empty.
+     *
+     *  When a thread exits, its pool is abandoned, still receives remote frees, and is adopted by the next new thread.
+     *  Memory is never returned to the system, blocks are recycled.
+     */
+    template <std::size_t BlockSize, std::size_t BlockAlign = alignof(std::max_align_t)>
+    class owner_pool
+    {
+    public:
+        static constexpr std::size_t block_size = BlockSize < sizeof(void*) ? sizeof(void*) : BlockSize;
+        static constexpr std::size_t block_alignment = BlockAlign < alignof(void*) ? alignof(void*) : BlockAlign;
+
+        // remote frees collected before they are pushed to the owner.
+        static constexpr std::size_t remote_batch_size = 32;
+        // blocks carved at once when a pool runs empty.
+        static constexpr std::size_t chunk_blocks = 128;
+
+        owner_pool(owner_pool const&) = delete;
+        owner_pool& operator=(owner_pool const&) = delete;
+
+        /**
+         *  Allocates a block from the calling thread's pool. Throws std::bad_alloc if the system is out of memory.
+         */
+        static void* allocate()
+        {
+            owner_pool& pool = local().owned();
+            if (!pool.free_)
+                pool.collect();
+            if (!pool.free_)
+                pool.carve();
+            free_block* block = pool.free_;
+            pool.free_ = block->next;
+            return block;
+        }
+
+        /**
+         *  Returns a block to the pool it was allocated from, on any thread.
+         */
+        static void deallocate(void* p) noexcept
+        {
+            if (!p)
+                return;
+            thread_state& state = local();
+            owner_pool* owner = owner_of(p);
+            free_block* block = static_cast <free_block*> (p);
+
+            if (owner == state.pool)
+            {
+                block->next = owner->free_;
+                owner->free_ = block;
+                return;
+            }
+
+            remote_batch& batch = state.batch;
+            if (batch.owner != owner)
+            {
+                batch.flush();
+                batch.owner = owner;
+            }
+            block->next = batch.head;
+            if (!batch.head)
+                batch.tail = block;
+            batch.head = block;
+            if (++batch.count == remote_batch_size)
+                batch.flush();
+        }
+
+    private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        static constexpr std::size_t header_size = (sizeof(owner_pool*) + block_alignment - 1) / block_alignment * block_alignment;
+        static constexpr std::size_t stride = header_size + (block_size + block_alignment - 1) / block_alignment * block_alignment;
+
+        struct remote_batch
+        {
+            owner_pool* owner = nullptr;
+            free_block* head = nullptr;
+            free_block* tail = nullptr;
+            std::size_t count = 0;
+
+            void flush() noexcept
+            {
+                if (!head)
+                    return;
+                free_block* expected = owner->remote_.load(std::memory_order_relaxed);
+                do
+                    tail->next = expected;
+                while (!owner->remote_.compare_exchange_weak(expected, head,
+                                                             std::memory_order_release, std::memory_order_relaxed));
+                head = tail = nullptr;
+                count = 0;
+            }
+        };
+
+        struct thread_state
+        {
+            owner_pool* pool = nullptr;
+            remote_batch batch;
+
+            owner_pool& owned()
+            {
+                if (!pool)
+                    pool = adopt();
+                return *pool;
+            }
+
+            ~thread_state()
+            {
+                batch.flush();
+                if (pool)
+                    abandon(pool);
+            }
+        };
+
+        // pools of exited threads, waiting to be adopted. never destroyed.
+        // an intrusive list, so that abandoning a pool cannot fail.
+        struct registry
+        {
+            std::mutex mutex;
+            owner_pool* abandoned = nullptr;
+        };
+
+        owner_pool() noexcept
+            : free_(nullptr)
+            , remote_(nullptr)
+            , next_abandoned_(nullptr)
+        {
+        }
+
+        static thread_state& local()
+        {
+            thread_local thread_state state;
+            return state;
+        }
+
+        static registry& pools()
+        {
+            static registry* r = new registry();
+            return *r;
+        }
+
+        static owner_pool* adopt()
+        {
+            registry& r = pools();
+            {
+                std::lock_guard <std::mutex> lock(r.mutex);
+                if (owner_pool* pool = r.abandoned)
+                {
+                    r.abandoned = pool->next_abandoned_;
+                    pool->next_abandoned_ = nullptr;
+                    return pool;
+                }
+            }
+            return new owner_pool();
+        }
+
+        static void abandon(owner_pool* pool) noexcept
+        {
+            registry& r = pools();
+            std::lock_guard <std::mutex> lock(r.mutex);
+            pool->next_abandoned_ = r.abandoned;
+            r.abandoned = pool;
+        }
+
+        static owner_pool* owner_of(void* p) noexcept
+        {
+            owner_pool* owner;
+            std::memcpy(&owner, static_cast <unsigned char*> (p) - sizeof(owner), sizeof(owner));
+            return owner;
+        }
+
+        // takes all blocks freed by other threads.
+        void collect() noexcept
+        {
+            free_ = remote_.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        void carve()
+        {
+#if defined(__cpp_aligned_new)
+            unsigned char* chunk = static_cast <unsigned char*> (::operator new(stride * chunk_blocks, std::align_val_t(block_alignment)));
+#else
+            static_assert(block_alignment <= alignof(std::max_align_t), "over-aligned blocks need C++17");
+            unsigned char* chunk = static_cast <unsigned char*> (::operator new(stride * chunk_blocks));
+#endif
+            owner_pool* self = this;
+            for (std::size_t i = chunk_blocks; i != 0; --i)
+            {
+                unsigned char* header = chunk + (i - 1) * stride;
+                std::memcpy(header + header_size - sizeof(self), &self, sizeof(self));
+                free_block* block = reinterpret_cast <free_block*> (header + header_size);
+                block->next = free_;
+                free_ = block;
+            }
+        }
+
+    private:
+        // owner thread only.
+        free_block* free_;
+        std::atomic <free_block*> remote_;
+        // guarded by the registry's mutex.
+        owner_pool* next_abandoned_;
+    };
+
+    /**
+     *  The pool owner_clone, owner_delete and make_owner_value use for T.
+     */
+    template <typename T>
+    using owner_pool_for = owner_pool <sizeof(T), alignof(T)>;
+
+    /**
+     *  Destroys an object of exactly type T and returns its memory to the thread that allocated it.
+     */
+    template <typename T>
+    struct owner_delete {
+        constexpr owner_delete() noexcept = default;
+
+        void operator()(T* p) const noexcept {
+            if (!p)
+                return;
+            p->~T();
+            owner_pool_for <T>::deallocate(p);
+        }
+    };
+
+    /**
+     *  Copy constructs T into memory from the calling thread's pool. T must be the dynamic type of the pointee.
+     */
+    template <typename T>
+    struct owner_clone {
+        constexpr owner_clone() noexcept = default;
+
+        T* operator()(T* other) const {
+            return construct(*other);
+        }
+
+        /**
+         *  Constructs a T in memory from the calling thread's pool.
+         */
+        template <typename... List>
+        static T* construct(List&&... list) {
+            void* mem = owner_pool_for <T>::allocate();
+            std::unique_ptr <void, pool_return> guard(mem);
+            T* result = ::new (mem) T(std::forward <List> (list)...);
+            guard.release();
+            return result;
+        }
+
+    private:
+        struct pool_return
+        {
+            void operator()(void* p) const noexcept
+            {
+                owner_pool_for <T>::deallocate(p);
+            }
+        };
+    };
+
+    template <typename T>
+    using owner_value_ptr = value_ptr <T, owner_clone <T>, owner_delete <T> >;
+
+    template <typename T, typename... List>
+    owner_value_ptr <T> make_owner_value(List&&... list)
+    {
+        return owner_value_ptr <T> (owner_clone <T>::construct(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_OWNER_POOL_HPP_INCLUDED
@@ -0,0 +1,305 @@
+#ifndef SIMPLE_UTIL_PERCPU_POOL_HPP_INCLUDED
+#define SIMPLE_UTIL_PERCPU_POOL_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <utility>
+
+#if defined(__linux__)
+#   include <sched.h>
+#   include <unistd.h>
+#endif
+
+namespace sutil
+{
+    /**
+     *  A memory pool for blocks of BlockSize bytes, with one small freelist cache per CPU in front of a shared depot.
+     *  The cost in memory is bounded by the number of cores, not the number of threads.
+     *
+     *  The current CPU is read with sched_getcpu(), which current glibc answers from the restartable sequences (rseq)
+     *  area it registers for every thread, without a syscall. Each CPU cache is guarded by its own spinlock, which is
+     *  uncontended unless a thread is migrated in the middle of an operation. Where the CPU cannot be determined,
+     *  a thread local cache is used instead.
+     *
+     *  Memory is never returned to the system, blocks are recycled.
+     */
+    template <std::size_t BlockSize, std::size_t BlockAlign = alignof(std::max_align_t)>
+    class percpu_pool
+    {
+    public:
+        static constexpr std::size_t block_size = BlockSize < sizeof(void*) ? sizeof(void*) : BlockSize;
+        static constexpr std::size_t block_alignment = BlockAlign < alignof(void*) ? alignof(void*) : BlockAlign;
+
+        // blocks kept per cache before half of them go back to the depot.
+        static constexpr std::size_t cache_capacity = 64;
+        // blocks carved at once when the depot runs empty.
+        static constexpr std::size_t chunk_blocks = 256;
+
+        /**
+         *  The pool for this block size. Never destroyed, so it can be used during static destruction.
+         */
+        static percpu_pool& instance()
+        {
+            static percpu_pool* pool = new percpu_pool();
+            return *pool;
+        }
+
+        percpu_pool(percpu_pool const&) = delete;
+        percpu_pool& operator=(percpu_pool const&) = delete;
+
+        /**
+         *  Allocates a block. Throws std::bad_alloc if the system is out of memory.
+         */
+        void* allocate()
+        {
+            cache* c = current_cache();
+            lock_guard lock(*c);
+            if (!c->head)
+                refill(*c);
+            free_block* block = c->head;
+            c->head = block->next;
+            --c->count;
+            return block;
+        }
+
+        /**
+         *  Returns a block that was allocated from this pool, on any thread.
+         */
+        void deallocate(void* p) noexcept
+        {
+            if (!p)
+                return;
+            cache* c = current_cache();
+            lock_guard lock(*c);
+            free_block* block = static_cast <free_block*> (p);
+            block->next = c->head;
+            c->head = block;
+            if (++c->count > cache_capacity)
+                drain(*c, cache_capacity / 2);
+        }
+
+    private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        struct alignas(64) cache
+        {
+            std::atomic_flag busy = ATOMIC_FLAG_INIT;
+            free_block* head = nullptr;
+            std::size_t count = 0;
+        };
+
+        struct lock_guard
+        {
+            cache& c;
+
+            explicit lock_guard(cache& c) noexcept
+                : c(c)
+            {
+                while (c.busy.test_and_set(std::memory_order_acquire))
+                    std::this_thread::yield();
+            }
+
+            ~lock_guard()
+            {
+                c.busy.clear(std::memory_order_release);
+            }
+        };
+
+        // fallback cache, returns its blocks to the depot when the thread exits.
+        struct thread_cache
+        {
+            cache c;
+
+            ~thread_cache()
+            {
+                instance().drain(c, c.count);
+            }
+        };
+
+        percpu_pool()
+            : cpu_count_(cpu_count())
+            , cpu_caches_(make_caches(cpu_count_))
+            , depot_mutex_()
+            , depot_(nullptr)
+            , chunks_()
+        {
+        }
+
+        // never freed, like the pool. aligned by hand, operator new only guarantees the default alignment before C++17.
+        static cache* make_caches(std::size_t n)
+        {
+            std::size_t space = n * sizeof(cache) + alignof(cache) - 1;
+            void* mem = ::operator new(space);
+            cache* caches = static_cast <cache*> (std::align(alignof(cache), n * sizeof(cache), mem, space));
+            for (std::size_t i = 0; i != n; ++i)
+                ::new (caches + i) cache();
+            return caches;
+        }
+
+        static std::size_t cpu_count() noexcept
+        {
+#if defined(__linux__)
+            long n = ::sysconf(_SC_NPROCESSORS_CONF);
+            if (n > 0)
+                return static_cast <std::size_t> (n);
+#endif
+            unsigned n2 = std::thread::hardware_concurrency();
+            return n2 ? n2 : 1;
+        }
+
+        cache* current_cache()
+        {
+#if defined(__linux__)
+            int cpu = ::sched_getcpu();
+            if (cpu >= 0)
+                return &cpu_caches_[static_cast <std::size_t> (cpu) % cpu_count_];
+#endif
+            thread_local thread_cache local;
+            return &local.c;
+        }
+
+        // moves a batch from the depot into c. carves a new chunk if the depot is empty.
+        void refill(cache& c)
+        {
+            std::lock_guard <std::mutex> lock(depot_mutex_);
+            if (!depot_)
+                carve();
+            for (std::size_t i = 0; i != cache_capacity / 2 && depot_; ++i)
+            {
+                free_block* block = depot_;
+                depot_ = block->next;
+                block->next = c.head;
+                c.head = block;
+                ++c.count;
+            }
+        }
+
+        // moves n blocks from c into the depot.
+        void drain(cache& c, std::size_t n) noexcept
+        {
+            std::lock_guard <std::mutex> lock(depot_mutex_);
+            for (; n != 0 && c.head; --n)
+            {
+                free_block* block = c.head;
+                c.head = block->next;
+                --c.count;
+                block->next = depot_;
+                depot_ = block;
+            }
+        }
+
+        void carve()
+        {
+            static constexpr std::size_t stride = (block_size + block_alignment - 1) / block_alignment * block_alignment;
+
+            chunks_.reserve(chunks_.size() + 1);
+#if defined(__cpp_aligned_new)
+            unsigned char* chunk = static_cast <unsigned char*> (::operator new(stride * chunk_blocks, std::align_val_t(block_alignment)));
+#else
+            static_assert(block_alignment <= alignof(std::max_align_t), "over-aligned blocks need C++17");
+            unsigned char* chunk = static_cast <unsigned char*> (::operator new(stride * chunk_blocks));
+#endif
+            chunks_.push_back(chunk);
+            for (std::size_t i = chunk_blocks; i != 0; --i)
+            {
+                free_block* block = reinterpret_cast <free_block*> (chunk + (i - 1) * stride);
+                block->next = depot_;
+                depot_ = block;
+            }
+        }
+
+    private:
+        std::size_t cpu_count_;
+        cache* cpu_caches_;
+        std::mutex depot_mutex_;
+        free_block* depot_;
+        std::vector <unsigned char*> chunks_;
+    };
+
+    template <std::size_t BlockSize, std::size_t BlockAlign>
+    constexpr std::size_t percpu_pool <BlockSize, BlockAlign>::block_size;
+
+    template <std::size_t BlockSize, std::size_t BlockAlign>
+    constexpr std::size_t percpu_pool <BlockSize, BlockAlign>::block_alignment;
+
+    template <std::size_t BlockSize, std::size_t BlockAlign>
+    constexpr std::size_t percpu_pool <BlockSize, BlockAlign>::cache_capacity;
+
+    template <std::size_t BlockSize, std::size_t BlockAlign>
+    constexpr std::size_t percpu_pool <BlockSize, BlockAlign>::chunk_blocks;
+
+    /**
+     *  The pool percpu_clone, percpu_delete and make_percpu_value use for T.
+     */
+    template <typename T>
+    using percpu_pool_for = percpu_pool <sizeof(T), alignof(T)>;
+
+    /**
+     *  Destroys an object of exactly type T and returns its memory to the per-CPU pool.
+     */
+    template <typename T>
+    struct percpu_delete {
+        constexpr percpu_delete() noexcept = default;
+
+        void operator()(T* p) const noexcept {
+            if (!p)
+                return;
+            p->~T();
+            percpu_pool_for <T>::instance().deallocate(p);
+        }
+    };
+
+    /**
+     *  Copy constructs T into memory from the per-CPU pool. T must be the dynamic type of the pointee.
+     */
+    template <typename T>
+    struct percpu_clone {
+        constexpr percpu_clone() noexcept = default;
+
+        T* operator()(T* other) const {
+            return construct(*other);
+        }
+
+        /**
+         *  Constructs a T in memory from the per-CPU pool.
+         */
+        template <typename... List>
+        static T* construct(List&&... list) {
+            void* mem = percpu_pool_for <T>::instance().allocate();
+            std::unique_ptr <void, pool_return> guard(mem);
+            T* result = ::new (mem) T(std::forward <List> (list)...);
+            guard.release();
+            return result;
+        }
+
+    private:
+        struct pool_return
+        {
+            void operator()(void* p) const noexcept
+            {
+                percpu_pool_for <T>::instance().deallocate(p);
+            }
+        };
+    };
+
+    template <typename T>
+    using percpu_value_ptr = value_ptr <T, percpu_clone <T>, percpu_delete <T> >;
+
+    template <typename T, typename... List>
+    percpu_value_ptr <T> make_percpu_value(List&&... list)
+    {
+        return percpu_value_ptr <T> (percpu_clone <T>::construct(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_PERCPU_POOL_HPP_INCLUDED
@@ -0,0 +1,418 @@
+#ifndef SIMPLE_UTIL_SLAB_ALLOCATOR_HPP_INCLUDED
+#define SIMPLE_UTIL_SLAB_ALLOCATOR_HPP_INCLUDED
+
+#include "value_ptr.hpp"
+
+#include <mutex>
+#include <new>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  A size-class slab allocator for polymorphic clones, whose size is only known at runtime (dynamic_size()).
+     *
+     *  Requests up to max_small_size bytes are rounded up to a size class. Each size class owns slabs of slab_size bytes,
+     *  each with its own freelist. In front of the slabs, every thread has a magazine of free blocks per size class,
+     *  so that most allocations and deallocations touch neither a lock nor a slab.
+     *  Deallocation is sized: the caller passes the size, the size class is computed from it, no header is read.
+     *  Only when a magazine overflows, its blocks are returned to their slabs, found by masking the address.
+     *  Slabs that become empty are given back to the system, except for one per size class.
+     *
+     *  Bigger or over-aligned requests go to the global operator new.
+     */
+    class slab_allocator
+    {
+    public:
+        static constexpr std::size_t slab_size = 64 * 1024;
+        static constexpr std::size_t max_small_size = 4096;
+        static constexpr std::size_t small_alignment = 16;
+        static constexpr std::size_t class_count = 28;
+        static constexpr std::size_t magazine_capacity = 32;
+
+        /**
+         *  The allocator. Never destroyed, so it can be used during static destruction.
+         *  A thread whose magazines are already destroyed (at thread exit, or in static destructors
+         *  running after the main thread's thread_local objects) bypasses them and locks the size class for every call.
+         */
+        static slab_allocator& instance()
+        {
+            static slab_allocator* allocator = new slab_allocator();
+            return *allocator;
+        }
+
+        slab_allocator(slab_allocator const&) = delete;
+        slab_allocator& operator=(slab_allocator const&) = delete;
+
+        /**
+         *  Size class of a request of size bytes. Requires 0 < size <= max_small_size.
+         *  Classes are 16 bytes apart up to 128 bytes, then 4 classes per power of two.
+         */
+        static std::size_t size_class(std::size_t size) noexcept
+        {
+            if (size <= 128)
+                return size == 0 ? 0 : (size - 1) / 16;
+            std::size_t power = 128;
+            std::size_t index = 8;
+            while (size > power * 2)
+            {
+                power *= 2;
+                index += 4;
+            }
+            return index + (size - 1 - power) / (power / 4);
+        }
+
+        /**
+         *  Block size of a size class.
+         */
+        static std::size_t class_size(std::size_t index) noexcept
+        {
+            if (index < 8)
+                return (index + 1) * 16;
+            std::size_t power = std::size_t(128) << ((index - 8) / 4);
+            return power + (power / 4) * ((index - 8) % 4 + 1);
+        }
+
+        /**
+         *  Allocates size bytes aligned to align. Throws std::bad_alloc if the system is out of memory.
+         */
+        void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t))
+        {
+            if (size > max_small_size || align > small_alignment)
+                return large_allocate(size, align);
+
+            std::size_t index = size_class(size);
+            if (magazines_destroyed())
+            {
+                magazine m;
+                refill(index, m);
+                void* p = m.blocks[--m.count];
+                flush(index, m, m.count);
+                return p;
+            }
+            magazine& m = local_magazines().classes[index];
+            if (m.count == 0)
+                refill(index, m);
+            return m.blocks[--m.count];
+        }
+
+        /**
+         *  Returns memory from allocate. size and align must be the values passed to allocate.
+         */
+        void deallocate(void* p, std::size_t size, std::size_t align = alignof(std::max_align_t)) noexcept
+        {
+            if (!p)
+                return;
+            if (size > max_small_size || align > small_alignment)
+                return large_deallocate(p, size, align);
+
+            std::size_t index = size_class(size);
+            if (magazines_destroyed())
+            {
+                magazine m;
+                m.blocks[m.count++] = p;
+                return flush(index, m, 1);
+            }
+            magazine& m = local_magazines().classes[index];
+            if (m.count == magazine_capacity)
+                flush(index, m, magazine_capacity / 2);
+            m.blocks[m.count++] = p;
+        }
+
+    private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        // lives at the start of each slab, blocks follow at header_size.
+        struct slab
+        {
+            // the allocation the slab lives in.
+            void* base;
+            slab* prev;
+            slab* next;
+            free_block* free;
+            std::size_t used;
+            std::size_t carved;
+            std::size_t capacity;
+            bool partial;
+        };
+
+        static constexpr std::size_t header_size = (sizeof(slab) + 63) / 64 * 64;
+
+        struct size_class_state
+        {
+            std::mutex mutex;
+            slab* partial = nullptr;
+            std::size_t partial_count = 0;
+        };
+
+        struct magazine
+        {
+            std::size_t count = 0;
+            void* blocks[magazine_capacity];
+        };
+
+        // returns all cached blocks to their slabs when the thread exits.
+        struct thread_magazines
+        {
+            magazine classes[class_count];
+
+            ~thread_magazines()
+            {
+                magazines_destroyed() = true;
+                for (std::size_t i = 0; i != class_count; ++i)
+                    instance().flush(i, classes[i], classes[i].count);
+            }
+        };
+
+        slab_allocator() = default;
+
+        static thread_magazines& local_magazines()
+        {
+            thread_local thread_magazines magazines;
+            return magazines;
+        }
+
+        // trivially destructible, so that it can still be read after the magazines are destroyed.
+        static bool& magazines_destroyed() noexcept
+        {
+            thread_local bool destroyed = false;
+            return destroyed;
+        }
+
+        static slab* slab_of(void* p) noexcept
+        {
+            return reinterpret_cast <slab*> (reinterpret_cast <std::uintptr_t> (p) & ~std::uintptr_t(slab_size - 1));
+        }
+
+        void refill(std::size_t index, magazine& m)
+        {
+            size_class_state& state = classes_[index];
+            std::size_t const block = class_size(index);
+            std::lock_guard <std::mutex> lock(state.mutex);
+
+            while (m.count < magazine_capacity / 2)
+            {
+                slab* s = state.partial;
+                if (!s)
+                {
+                    s = new_slab(block);
+                    link(state, s);
+                }
+
+                while (m.count < magazine_capacity / 2 && s->used < s->capacity)
+                {
+                    void* p;
+                    if (s->free)
+                    {
+                        p = s->free;
+                        s->free = s->free->next;
+                    }
+                    else
+                    {
+                        p = reinterpret_cast <unsigned char*> (s) + header_size + s->carved * block;
+                        ++s->carved;
+                    }
+                    ++s->used;
+                    m.blocks[m.count++] = p;
+                }
+
+                if (s->used == s->capacity)
+                    unlink(state, s);
+            }
+        }
+
+        void flush(std::size_t index, magazine& m, std::size_t n) noexcept
+        {
+            size_class_state& state = classes_[index];
+            std::lock_guard <std::mutex> lock(state.mutex);
+
+            for (; n != 0 && m.count != 0; --n)
+            {
+                void* p = m.blocks[--m.count];
+                slab* s = slab_of(p);
+                free_block* block = static_cast <free_block*> (p);
+                block->next = s->free;
+                s->free = block;
+                --s->used;
+
+                if (!s->partial)
+                    link(state, s);
+                else if (s->used == 0 && state.partial_count > 1)
+                {
+                    unlink(state, s);
+                    delete_slab(s);
+                }
+            }
+        }
+
+        static void link(size_class_state& state, slab* s) noexcept
+        {
+            s->prev = nullptr;
+            s->next = state.partial;
+            if (state.partial)
+                state.partial->prev = s;
+            state.partial = s;
+            s->partial = true;
+            ++state.partial_count;
+        }
+
+        static void unlink(size_class_state& state, slab* s) noexcept
+        {
+            if (s->prev)
+                s->prev->next = s->next;
+            else
+                state.partial = s->next;
+            if (s->next)
+                s->next->prev = s->prev;
+            s->partial = false;
+            --state.partial_count;
+        }
+
+        static slab* new_slab(std::size_t block)
+        {
+#if defined(__cpp_aligned_new)
+            void* base = ::operator new(slab_size, std::align_val_t(slab_size));
+            void* mem = base;
+#else
+            // no aligned new, over-allocate and align by hand.
+            void* base = ::operator new(2 * slab_size);
+            void* mem = reinterpret_cast <void*> ((reinterpret_cast <std::uintptr_t> (base) + slab_size - 1) & ~std::uintptr_t(slab_size - 1));
+#endif
+            slab* s = ::new (mem) slab();
+            s->base = base;
+            s->capacity = (slab_size - header_size) / block;
+            return s;
+        }
+
+        static void delete_slab(slab* s) noexcept
+        {
+            void* base = s->base;
+            s->~slab();
+#if defined(__cpp_aligned_new)
+            ::operator delete(base, slab_size, std::align_val_t(slab_size));
+#else
+            ::operator delete(base);
+#endif
+        }
+
+        static void* large_allocate(std::size_t size, std::size_t align)
+        {
+#if defined(__cpp_aligned_new)
+            if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                return ::operator new(size, std::align_val_t(align));
+#endif
+            static_cast <void> (align);
+            return ::operator new(size);
+        }
+
+        static void large_deallocate(void* p, std::size_t size, std::size_t align) noexcept
+        {
+#if defined(__cpp_aligned_new)
+            if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+                return ::operator delete(p, size, std::align_val_t(align));
+#endif
+            static_cast <void> (align);
+#if defined(__cpp_sized_deallocation)
+            ::operator delete(p, size);
+#else
+            static_cast <void> (size);
+            ::operator delete(p);
+#endif
+        }
+
+    private:
+        size_class_state classes_[class_count];
+    };
+
+    /**
+     *  Clones a placement_cloneable into memory from the slab_allocator, sized by dynamic_size().
+     */
+    template <typename T>
+    struct slab_clone {
+        constexpr slab_clone() noexcept = default;
+
+        template <typename U>
+        constexpr slab_clone(slab_clone <U> const&) noexcept {}
+
+        T* operator()(T* other) const {
+            std::size_t const size = other->dynamic_size();
+            std::size_t const align = other->dynamic_alignment();
+            slab_allocator& allocator = slab_allocator::instance();
+            void* mem = allocator.allocate(size, align);
+            std::unique_ptr <void, sized_return> guard(mem, sized_return{size, align});
+            T* result = static_cast <T*> (other->clone_into(mem));
+            guard.release();
+            return result;
+        }
+
+    private:
+        struct sized_return
+        {
+            std::size_t size;
+            std::size_t align;
+
+            void operator()(void* p) const noexcept
+            {
+                slab_allocator::instance().deallocate(p, size, align);
+            }
+        };
+    };
+
+    /**
+     *  Destroys a placement_cloneable and returns its memory to the slab_allocator, sized by dynamic_size().
+     */
+    template <typename T>
+    struct slab_delete {
+        constexpr slab_delete() noexcept = default;
+
+        template <typename U>
+        constexpr slab_delete(slab_delete <U> const&) noexcept {}
+
+        void operator()(T* p) const noexcept {
+            if (!p)
+                return;
+            std::size_t const size = p->dynamic_size();
+            std::size_t const align = p->dynamic_alignment();
+            // the dynamic type was constructed at the start of the block.
+            void* mem = dynamic_cast <void*> (p);
+            p->~T();
+            slab_allocator::instance().deallocate(mem, size, align);
+        }
+    };
+
+    template <typename T>
+    using slab_value_ptr = value_ptr <T, slab_clone <T>, slab_delete <T> >;
+
+    /**
+     *  Creates a DerivedT in memory from the slab_allocator, held by a slab_value_ptr <BaseT>.
+     */
+    template <typename DerivedT, typename BaseT = DerivedT, typename... List>
+    slab_value_ptr <BaseT> make_slab_value(List&&... list)
+    {
+        slab_allocator& allocator = slab_allocator::instance();
+        void* mem = allocator.allocate(sizeof(DerivedT), alignof(DerivedT));
+        DerivedT* result;
+        {
+            struct guard_type
+            {
+                void* mem;
+                ~guard_type()
+                {
+                    if (mem)
+                        slab_allocator::instance().deallocate(mem, sizeof(DerivedT), alignof(DerivedT));
+                }
+            } guard{mem};
+            result = ::new (mem) DerivedT(std::forward <List> (list)...);
+            guard.mem = nullptr;
+        }
+        return slab_value_ptr <BaseT> (result);
+    }
+}
+
+#endif // SIMPLE_UTIL_SLAB_ALLOCATOR_HPP_INCLUDED
@@ -0,0 +1,108 @@
+#ifndef SIMPLE_UTIL_STATIC_VALUE_HPP_INCLUDED
+#define SIMPLE_UTIL_STATIC_VALUE_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+#include "value_ptr.hpp"
+
+#include <type_traits>
+#include <utility>
+
+namespace sutil
+{
+    template <typename T>
+    class static_value;
+
+    namespace detail
+    {
+        // is the argument list a single static_value, which must not go to the in-place constructor?
+        template <typename T, typename... List>
+        struct is_static_value_copy : std::false_type
+        {
+        };
+
+        template <typename T, typename U>
+        struct is_static_value_copy <T, U> : std::is_same <typename std::decay <U>::type, static_value <T> >
+        {
+        };
+    }
+
+    /**
+     *  A static_value is a prototype object that is meant to be constant-initialized, e.g.:
+     *
+     *      constexpr sutil::static_value <config> default_config{8, "worker"};
+     *
+     *  A constexpr static_value is constant-initialized, so it costs nothing at startup
+     *  (and, being const, is usually placed in read-only storage).
+     *  Copies are taken with share(), which returns cow_ptrs that refer to the prototype
+     *  until they are first modified. Only then is the prototype cloned onto the heap.
+     *
+     *  T needs a constexpr constructor (and, if polymorphic, a constexpr destructor, so C++20).
+     */
+    template <typename T>
+    class static_value
+    {
+    public:
+        using element_type = T;
+
+        /**
+         *  Constructs the prototype in place.
+         */
+        template <typename... List,
+                  typename = typename std::enable_if <!detail::is_static_value_copy <T, List...>::value>::type>
+        constexpr explicit static_value(List&&... list)
+            : value_(std::forward <List> (list)...)
+        {
+        }
+
+        static_value(static_value const&) = delete;
+        static_value& operator=(static_value const&) = delete;
+
+        /**
+         *  Retrieves the prototype.
+         */
+        constexpr T const& get() const noexcept
+        {
+            return value_;
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        constexpr T const& operator*() const noexcept
+        {
+            return value_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        constexpr T const* operator->() const noexcept
+        {
+            return &value_;
+        }
+
+        /**
+         *  Returns a copy-on-write pointer that shares the prototype until it is modified.
+         *  Does not allocate.
+         */
+        template <typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+        cow_ptr <T, ClonerT, DeleterT> share() const noexcept
+        {
+            return cow_ptr <T, ClonerT, DeleterT>::borrow(value_);
+        }
+
+        /**
+         *  Returns an eager, owning copy of the prototype. Cannot be noexcept, because clone may throw.
+         */
+        template <typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+        value_ptr <T, ClonerT, DeleterT> clone() const
+        {
+            return value_ptr <T, ClonerT, DeleterT> (ClonerT()(const_cast <T*> (&value_)));
+        }
+
+    private:
+        T value_;
+    };
+}
+
+#endif // SIMPLE_UTIL_STATIC_VALUE_HPP_INCLUDED
@@ -0,0 +1,296 @@
+#ifndef SIMPLE_UTIL_TRACKED_PTR_HPP_INCLUDED
+#define SIMPLE_UTIL_TRACKED_PTR_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace sutil
+{
+    namespace detail
+    {
+        // logical clock for modification stamps. snapshots advance it, modifications only read it.
+        inline std::atomic <std::uint64_t>& tracked_clock() noexcept
+        {
+            static std::atomic <std::uint64_t> clock{1};
+            return clock;
+        }
+    }
+
+    template <typename T, typename ClonerT, typename DeleterT>
+    class tracked_ptr;
+
+    /**
+     *  An immutable snapshot of a tree of tracked_ptrs, made by tracked_ptr::incremental_clone.
+     *  It shares all nodes with the live tree that have not been modified since.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class tracked_snapshot
+    {
+    public:
+        using const_pointer = T const*;
+        using element_type = T;
+
+        /**
+         *  Creates an empty snapshot.
+         */
+        tracked_snapshot() noexcept
+            : root_()
+            , taken_at_(0)
+        {
+        }
+
+        /**
+         *  Convenient dereferencing operator.
+         */
+        T const& operator*() const
+        {
+            return *root_;
+        }
+
+        /**
+         *  Convenient arrow operator.
+         */
+        const_pointer operator->() const noexcept
+        {
+            return root_.get();
+        }
+
+        /**
+         *  Retrieves the root of the snapshot.
+         */
+        const_pointer get() const noexcept
+        {
+            return root_.get();
+        }
+
+        /**
+         *  Logical time the snapshot was taken at.
+         */
+        std::uint64_t taken_at() const noexcept
+        {
+            return taken_at_;
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return static_cast <bool> (root_);
+        }
+
+    private:
+        friend class tracked_ptr <T, ClonerT, DeleterT>;
+
+        tracked_snapshot(cow_ptr <T, ClonerT, DeleterT> const& root, std::uint64_t taken_at) noexcept
+            : root_(root)
+            , taken_at_(taken_at)
+        {
+        }
+
+    private:
+        cow_ptr <T, ClonerT, DeleterT> root_;
+        std::uint64_t taken_at_;
+    };
+
+    /**
+     *  A value_ptr alternative with dirty tracking, for trees that are snapshotted periodically.
+     *  Nodes of such a tree hold their children in tracked_ptrs.
+     *
+     *  Mutable access (non-const operator->, operator* or modify()) stamps the node as modified. Because a child
+     *  can only be reached mutably through mutable access to its parent, all ancestors are stamped as well.
+     *  Copies share the pointee until they are modified, so incremental_clone() is O(1): the snapshot
+     *  shares the whole tree, and subsequent modifications clone only the nodes on the modified paths.
+     *  Unmodified subtrees stay shared between the live tree and all snapshots.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class tracked_ptr
+    {
+    public:
+        using pointer = T*;
+        using const_pointer = T const*;
+        using element_type = T;
+        using deleter_type = DeleterT;
+        using cloner_type = ClonerT;
+        using snapshot_type = tracked_snapshot <T, ClonerT, DeleterT>;
+
+        /**
+         *  Creates an invalid tracked_ptr that has ownership of nothing.
+         */
+        tracked_ptr() noexcept
+            : ptr_()
+            , version_(0)
+        {
+        }
+
+        /**
+         *  Creates an invalid tracked_ptr that has ownership of nothing.
+         */
+        tracked_ptr(std::nullptr_t) noexcept
+            : tracked_ptr()
+        {
+        }
+
+        /**
+         *  Creates a new tracked_ptr from a raw owning pointer and aquires ownership.
+         *  The new object counts as modified.
+         *
+         *  @param ptr The pointer to take ownership of.
+         */
+        explicit tracked_ptr(T* ptr)
+            : ptr_(ptr)
+            , version_(now())
+        {
+        }
+
+        /**
+         *  Creates a new tracked_ptr from a raw owning pointer and aquires ownership.
+         *  Also sets a deleter function and a cloner function.
+         *
+         *  @param ptr The pointer to take ownership of.
+         *  @param d A deleter.
+         *  @param c A cloner.
+         */
+        tracked_ptr(T* ptr, deleter_type d, cloner_type c)
+            : ptr_(ptr, std::move(d), std::move(c))
+            , version_(now())
+        {
+        }
+
+        /**
+         *  Read only dereferencing operator. Does not count as modification.
+         */
+        T const& operator*() const
+        {
+            return *ptr_;
+        }
+
+        /**
+         *  Mutable dereferencing operator. Counts as modification.
+         */
+        T& operator*()
+        {
+            return *modify();
+        }
+
+        /**
+         *  Read only arrow operator. Does not count as modification.
+         */
+        const_pointer operator->() const noexcept
+        {
+            return ptr_.get();
+        }
+
+        /**
+         *  Mutable arrow operator. Counts as modification.
+         */
+        pointer operator->()
+        {
+            return modify();
+        }
+
+        /**
+         *  Retrieves the held pointee for reading.
+         */
+        const_pointer get() const noexcept
+        {
+            return ptr_.get();
+        }
+
+        /**
+         *  Retrieves the held pointee for writing, stamps this node as modified.
+         *  Clones the pointee first if it is shared with a snapshot.
+         *  The tracked_ptr remains unaltered if clone throws.
+         */
+        pointer modify()
+        {
+            pointer p = ptr_.modify();
+            version_ = now();
+            return p;
+        }
+
+        /**
+         *  Logical time of the last modification of this node or a node below it.
+         */
+        std::uint64_t version() const noexcept
+        {
+            return version_;
+        }
+
+        /**
+         *  Has this node or a node below it been modified since the snapshot was taken?
+         *  The snapshot may be of any tree containing this node, e.g. of the root.
+         */
+        template <typename U, typename ClonerU, typename DeleterU>
+        bool modified_since(tracked_snapshot <U, ClonerU, DeleterU> const& snapshot) const noexcept
+        {
+            return version_ > snapshot.taken_at();
+        }
+
+        /**
+         *  Takes a snapshot of the tree below this node. Returns previous if nothing was modified since.
+         *  Otherwise the new snapshot shares all nodes with the live tree and, for unmodified subtrees,
+         *  with previous. Cloning happens lazily, when the live tree is modified afterwards.
+         *
+         *  @param previous The last snapshot of this node, may be empty.
+         */
+        snapshot_type incremental_clone(snapshot_type const& previous = snapshot_type()) const
+        {
+            if (previous && previous.get() == get() && !modified_since(previous))
+                return previous;
+            return snapshot_type(ptr_, detail::tracked_clock().fetch_add(1, std::memory_order_relaxed));
+        }
+
+        /**
+         *  Resets the tracked_ptr with a new object. Counts as modification.
+         *  Does nothing if p is already held, e.g. from modify().
+         */
+        void reset(pointer p = pointer())
+        {
+            if (p == get())
+                return;
+            ptr_.reset(p);
+            version_ = now();
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return static_cast <bool> (ptr_);
+        }
+
+        /**
+         *  Swaps the pointee's.
+         */
+        void swap(tracked_ptr& v) noexcept
+        {
+            using std::swap;
+            ptr_.swap(v.ptr_);
+            swap(version_, v.version_);
+        }
+
+    private:
+        static std::uint64_t now() noexcept
+        {
+            return detail::tracked_clock().load(std::memory_order_relaxed);
+        }
+
+    private:
+        cow_ptr <T, ClonerT, DeleterT> ptr_;
+        std::uint64_t version_;
+    };
+
+    template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
+    tracked_ptr <T, ClonerT, DeleterT> make_tracked(List&&... list)
+    {
+        return tracked_ptr <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
+    }
+}
+
+#endif // SIMPLE_UTIL_TRACKED_PTR_HPP_INCLUDED
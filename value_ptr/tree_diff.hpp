@@ -0,0 +1,136 @@
+#ifndef SIMPLE_UTIL_TREE_DIFF_HPP_INCLUDED
+#define SIMPLE_UTIL_TREE_DIFF_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  Describes the structure of a tree node type to tree_diff and apply_patch. Specialize for your node type:
+     *
+     *      template <>
+     *      struct tree_traits <node>
+     *      {
+     *          static std::size_t child_count(node const& n);
+     *          static cow_ptr <node> const& child(node const& n, std::size_t index);
+     *          static cow_ptr <node>& child(node& n, std::size_t index);
+     *          // compares everything but the children.
+     *          static bool same_payload(node const& lhs, node const& rhs);
+     *      };
+     *
+     *  Children may be held in cow_ptrs or tracked_ptrs, the tree must be homogeneous.
+     */
+    template <typename T>
+    struct tree_traits;
+
+    /**
+     *  The difference between two trees, made by tree_diff.
+     *  Entries are in pre-order and refer to nodes of the target tree, which they share.
+     *
+     *  A patch is meant for the process that made it. To replicate a tree to another process, write out each entry's
+     *  path and keep_children with the node's payload, and with the whole subtree below node if keep_children is false.
+     *  On the other side, rebuild the entries from that and apply them to the tree the patch was made from.
+     */
+    template <typename PtrT>
+    struct tree_patch
+    {
+        struct entry
+        {
+            // child indices leading from the root to the changed node.
+            std::vector <std::size_t> path;
+
+            // the node in the target tree.
+            PtrT node;
+
+            // true: only the payload of the node changed, its children are kept and patched by later entries.
+            // false: the whole subtree is replaced by node.
+            bool keep_children;
+        };
+
+        std::vector <entry> entries;
+
+        bool empty() const noexcept
+        {
+            return entries.empty();
+        }
+    };
+
+    namespace detail
+    {
+        template <typename PtrT>
+        void tree_diff(PtrT const& from, PtrT const& to, std::vector <std::size_t>& path, tree_patch <PtrT>& patch)
+        {
+            using traits = tree_traits <typename PtrT::element_type>;
+
+            // shared subtree, or both empty.
+            if (from.get() == to.get())
+                return;
+
+            if (!from || !to || traits::child_count(*from) != traits::child_count(*to))
+            {
+                patch.entries.push_back({path, to, false});
+                return;
+            }
+
+            if (!traits::same_payload(*from, *to))
+                patch.entries.push_back({path, to, true});
+
+            for (std::size_t i = 0, end = traits::child_count(*to); i != end; ++i)
+            {
+                path.push_back(i);
+                tree_diff(traits::child(*from, i), traits::child(*to, i), path, patch);
+                path.pop_back();
+            }
+        }
+    }
+
+    /**
+     *  Computes the changes that turn the tree from into the tree to.
+     *  Subtrees that are shared between both trees are skipped without being visited,
+     *  so for trees derived from each other by copy-on-write the cost is proportional to the change.
+     */
+    template <typename PtrT>
+    tree_patch <PtrT> tree_diff(PtrT const& from, PtrT const& to)
+    {
+        tree_patch <PtrT> patch;
+        std::vector <std::size_t> path;
+        detail::tree_diff(from, to, path, patch);
+        return patch;
+    }
+
+    /**
+     *  Applies a patch made by tree_diff to root, which must have the structure of the tree the patch was made from.
+     *  Only the changed nodes and their ancestors are cloned (by modify()), everything else stays shared.
+     *  Cannot be noexcept, because clone may throw. root may be partially patched if clone throws.
+     */
+    template <typename PtrT>
+    void apply_patch(PtrT& root, tree_patch <PtrT> const& patch)
+    {
+        using traits = tree_traits <typename PtrT::element_type>;
+
+        for (auto const& e : patch.entries)
+        {
+            PtrT* target = &root;
+            for (auto index : e.path)
+                target = &traits::child(*target->modify(), index);
+
+            if (!e.keep_children)
+            {
+                *target = e.node;
+                continue;
+            }
+
+            PtrT replacement = e.node;
+            auto* fresh = replacement.modify();
+            for (std::size_t i = 0, end = traits::child_count(*fresh); i != end; ++i)
+                traits::child(*fresh, i) = traits::child(*target->get(), i);
+            *target = std::move(replacement);
+        }
+    }
+}
+
+#endif // SIMPLE_UTIL_TREE_DIFF_HPP_INCLUDED
@@ -0,0 +1,337 @@
+#ifndef SIMPLE_UTIL_VALUE_FUNCTION_HPP_INCLUDED
+#define SIMPLE_UTIL_VALUE_FUNCTION_HPP_INCLUDED
+
+#include <type_traits>
+#include <functional>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+namespace sutil
+{
+    template <typename Signature, std::size_t InlineBytes = 4 * sizeof(void*)>
+    class value_function;
+
+    namespace detail
+    {
+        template <typename R, typename... Args>
+        struct value_function_vtable
+        {
+            R (*invoke)(void* callable, Args&&... args);
+            void (*copy)(void const* from, void* to);
+            void (*relocate)(void* from, void* to) noexcept;
+            void (*destroy)(void* where) noexcept;
+        };
+
+        // calls f like std::invoke: member pointers through std::mem_fn.
+        template <typename FunctionT, typename... List>
+        auto value_function_call(std::false_type /* member pointer */, FunctionT& f, List&&... list)
+            -> decltype(f(std::forward <List> (list)...))
+        {
+            return f(std::forward <List> (list)...);
+        }
+
+        template <typename FunctionT, typename... List>
+        auto value_function_call(std::true_type /* member pointer */, FunctionT& f, List&&... list)
+            -> decltype(std::mem_fn(f)(std::forward <List> (list)...))
+        {
+            return std::mem_fn(f)(std::forward <List> (list)...);
+        }
+
+        /**
+         *  Is FunctionT callable with Args, with a result convertible to R?
+         */
+        template <typename FunctionT, typename R, typename... Args>
+        struct value_function_callable
+        {
+        private:
+            struct not_callable {};
+
+            template <typename F>
+            static auto result(int)
+                -> decltype(value_function_call(std::is_member_pointer <F> (), std::declval <F&> (), std::declval <Args> ()...));
+
+            template <typename F>
+            static not_callable result(...);
+
+            using result_type = decltype(result <FunctionT> (0));
+
+        public:
+            static constexpr bool value = !std::is_same <result_type, not_callable>::value &&
+                                          (std::is_void <R>::value || std::is_convertible <result_type, R>::value);
+        };
+
+        // null function pointers, null member pointers and empty function wrappers are empty, like in std::function.
+        template <typename FunctionT>
+        bool value_function_empty(FunctionT const& f, std::true_type /* pointer */) noexcept
+        {
+            return f == nullptr;
+        }
+
+        template <typename FunctionT>
+        bool value_function_empty(FunctionT const&, std::false_type /* pointer */) noexcept
+        {
+            return false;
+        }
+
+        template <typename FunctionT>
+        bool value_function_empty(FunctionT const& f) noexcept
+        {
+            return value_function_empty(f, std::integral_constant <bool, std::is_pointer <FunctionT>::value ||
+                                                                          std::is_member_pointer <FunctionT>::value> ());
+        }
+
+        template <typename Signature>
+        bool value_function_empty(std::function <Signature> const& f) noexcept
+        {
+            return !f;
+        }
+
+        template <typename Signature, std::size_t InlineBytes>
+        bool value_function_empty(value_function <Signature, InlineBytes> const& f) noexcept
+        {
+            return !f;
+        }
+
+        template <typename FunctionT, typename R, typename... Args>
+        struct value_function_ops
+        {
+            static R invoke(void* callable, Args&&... args)
+            {
+                return static_cast <R> (value_function_call(std::is_member_pointer <FunctionT> (),
+                                                            *static_cast <FunctionT*> (callable), std::forward <Args> (args)...));
+            }
+
+            static void copy(void const* from, void* to)
+            {
+                ::new (to) FunctionT(*static_cast <FunctionT const*> (from));
+            }
+
+            static void relocate(void* from, void* to) noexcept
+            {
+                ::new (to) FunctionT(std::move(*static_cast <FunctionT*> (from)));
+                static_cast <FunctionT*> (from)->~FunctionT();
+            }
+
+            static void destroy(void* where) noexcept
+            {
+                static_cast <FunctionT*> (where)->~FunctionT();
+            }
+
+            static constexpr value_function_vtable <R, Args...> table = {
+                &invoke, &copy, &relocate, &destroy
+            };
+        };
+
+        template <typename FunctionT, typename R, typename... Args>
+        constexpr value_function_vtable <R, Args...> value_function_ops <FunctionT, R, Args...>::table;
+    }
+
+    /**
+     *  A copyable callable wrapper like std::function, that never allocates.
+     *  The callable is always stored inline. Callables bigger than InlineBytes are rejected at compile time.
+     *  Callables must be nothrow move constructible, so that moving a value_function is noexcept.
+     *  Copying a value_function copy constructs the callable in place.
+     */
+    template <typename R, typename... Args, std::size_t InlineBytes>
+    class value_function <R(Args...), InlineBytes>
+    {
+    private:
+        // the converting constructor and assignment take callables other than value_function itself.
+        template <typename FunctionT>
+        using accepts = typename std::enable_if <!std::is_same <typename std::decay <FunctionT>::type, value_function>::value &&
+                                                 detail::value_function_callable <typename std::decay <FunctionT>::type, R, Args...>::value>::type;
+
+    public:
+        using result_type = R;
+
+        static constexpr std::size_t inline_size = InlineBytes;
+
+        /**
+         *  Creates an empty value_function.
+         */
+        constexpr value_function() noexcept
+            : vtable_(nullptr)
+            , storage_()
+        {
+        }
+
+        /**
+         *  Creates an empty value_function.
+         */
+        constexpr value_function(std::nullptr_t) noexcept
+            : vtable_(nullptr)
+            , storage_()
+        {
+        }
+
+        /**
+         *  Stores a copy of the callable. Only takes callables that can be called with Args and return something convertible to R.
+         *  A null function pointer, a null member pointer or an empty function wrapper gives an empty value_function.
+         */
+        template <typename FunctionT, typename = accepts <FunctionT> >
+        value_function(FunctionT&& f)
+            : vtable_(nullptr)
+        {
+            using function_type = typename std::decay <FunctionT>::type;
+
+            static_assert(sizeof(function_type) <= InlineBytes,
+                "callable does not fit into the inline storage of value_function");
+            static_assert(alignof(std::max_align_t) % alignof(function_type) == 0,
+                "callable is over-aligned for the inline storage of value_function");
+            static_assert(std::is_nothrow_move_constructible <function_type>::value,
+                "callable must be nothrow move constructible");
+
+            if (detail::value_function_empty(f))
+                return;
+            ::new (static_cast <void*> (storage_)) function_type(std::forward <FunctionT> (f));
+            vtable_ = &detail::value_function_ops <function_type, R, Args...>::table;
+        }
+
+        /**
+         *  Copies the callable. Not noexcept, because the copy constructor of the callable may throw.
+         */
+        value_function(value_function const& other)
+            : vtable_(nullptr)
+        {
+            if (other.vtable_)
+            {
+                other.vtable_->copy(other.storage_, storage_);
+                vtable_ = other.vtable_;
+            }
+        }
+
+        /**
+         *  Moves the callable over, other is empty afterwards.
+         */
+        value_function(value_function&& other) noexcept
+            : vtable_(nullptr)
+        {
+            take(other);
+        }
+
+        /**
+         *  Copy assignment.
+         */
+        value_function& operator=(value_function const& other)
+        {
+            value_function(other).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Move assignment.
+         */
+        value_function& operator=(value_function&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        /**
+         *  Clears the value_function.
+         */
+        value_function& operator=(std::nullptr_t) noexcept
+        {
+            reset();
+            return *this;
+        }
+
+        /**
+         *  Replacing assignment.
+         */
+        template <typename FunctionT, typename = accepts <FunctionT> >
+        value_function& operator=(FunctionT&& f)
+        {
+            value_function(std::forward <FunctionT> (f)).swap(*this);
+            return *this;
+        }
+
+        /**
+         *  Calls the stored callable. Throws std::bad_function_call if empty.
+         */
+        R operator()(Args... args) const
+        {
+            if (!vtable_)
+                throw std::bad_function_call{};
+            return vtable_->invoke(const_cast <unsigned char*> (storage_), std::forward <Args> (args)...);
+        }
+
+        /**
+         *  Is set? Does it hold something?
+         */
+        explicit operator bool() const noexcept
+        {
+            return vtable_ != nullptr;
+        }
+
+        /**
+         *  Destroys the stored callable.
+         */
+        void reset() noexcept
+        {
+            if (vtable_)
+            {
+                vtable_->destroy(storage_);
+                vtable_ = nullptr;
+            }
+        }
+
+        /**
+         *  Swaps the stored callables.
+         */
+        void swap(value_function& other) noexcept
+        {
+            if (this == &other)
+                return;
+            value_function temp(std::move(other));
+            other.take(*this);
+            take(temp);
+        }
+
+        /**
+         *  Destructor.
+         */
+        ~value_function()
+        {
+            reset();
+        }
+
+    private:
+        // requires *this to be empty.
+        void take(value_function& other) noexcept
+        {
+            if (other.vtable_)
+            {
+                other.vtable_->relocate(other.storage_, storage_);
+                vtable_ = other.vtable_;
+                other.vtable_ = nullptr;
+            }
+        }
+
+    private:
+        detail::value_function_vtable <R, Args...> const* vtable_;
+        alignas(std::max_align_t) unsigned char storage_[InlineBytes];
+    };
+
+    template <typename R, typename... Args, std::size_t InlineBytes>
+    constexpr std::size_t value_function <R(Args...), InlineBytes>::inline_size;
+
+    template <typename Signature, std::size_t InlineBytes>
+    bool operator==(value_function <Signature, InlineBytes> const& f, std::nullptr_t) noexcept
+    {
+        return !f;
+    }
+
+    template <typename Signature, std::size_t InlineBytes>
+    bool operator!=(value_function <Signature, InlineBytes> const& f, std::nullptr_t) noexcept
+    {
+        return static_cast <bool> (f);
+    }
+}
+
+#endif // SIMPLE_UTIL_VALUE_FUNCTION_HPP_INCLUDED
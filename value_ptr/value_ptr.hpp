@@ -2,17 +2,64 @@
 #define SIMPLE_UTIL_VALUE_PTR_HPP_INCLUDED
 
 #include "cloner.hpp"
+#include "config.hpp"
 
 #include <type_traits>
 #include <memory>
 #include <cassert>
 #include <tuple>
+#include <system_error>
+
+#if defined(__has_include)
+#   if __has_include(<expected>)
+#       include <expected>
+#   endif
+#endif
 
 namespace sutil
 {
+    namespace detail
+    {
+        template <typename PolicyT>
+        constexpr bool policy_engaged(PolicyT const&) noexcept
+        {
+            return true;
+        }
+
+        // function pointer policies are null when default constructed.
+        template <typename PolicyT>
+        constexpr bool policy_engaged(PolicyT* policy) noexcept
+        {
+            return policy != nullptr;
+        }
+    }
+
+    /**
+     *  The deleter of the shared_ptrs made by value_ptr::to_shared.
+     *  Keeps the cloner next to the deleter, so it can be recovered with std::get_deleter.
+     */
+    template <typename T, typename ClonerT, typename DeleterT>
+    struct shared_value_deleter
+    {
+        ClonerT cloner;
+        DeleterT deleter;
+
+        void operator()(T* p)
+        {
+            if (p)
+                deleter(p);
+        }
+    };
+
     /**
      *  A value_ptr shall fill the need for a smart pointer that clones the pointee.
      *  The pointee must provide a clone function or a cloner must be provided.
+     *  From C++20 on, the whole type can be used in constant expressions. Destroying a value_ptr
+     *  during constant evaluation additionally requires a constexpr deleter (std::default_delete is from C++23 on).
+     *
+     *  Cloner and deleter may be plain function pointers, to select policies at runtime without a template per policy.
+     *  They must be non-null whenever a pointee is held, empty value_ptrs may have null ones.
+     *  Empty policies take no space, so a value_ptr with two function pointer policies is three words.
      */
     template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
     class value_ptr
@@ -23,17 +70,20 @@ namespace sutil
         using deleter_type = DeleterT;
         using cloner_type = ClonerT;
 
+    private:
+        // the unique_ptr constructors take unique_ptrs whose pointer and deleter convert to ours.
+        template <typename U, typename DeleterU>
+        using takes_unique = typename std::enable_if <std::is_convertible <U*, T*>::value &&
+                                                      std::is_constructible <deleter_type, DeleterU&&>::value>::type;
+
+    public:
+
         /**
          *  Creates an invalid value_ptr that has ownership of nothing.
          */
         explicit constexpr value_ptr() noexcept
             : m_(nullptr, cloner_type(), deleter_type())
         {
-            static_assert(!std::is_pointer<deleter_type>::value,
-               "constructed with null function pointer deleter");
-
-            static_assert(!std::is_pointer<cloner_type>::value,
-               "constructed with null function pointer cloner");
         }
 
         /**
@@ -42,11 +92,6 @@ namespace sutil
         explicit constexpr value_ptr(std::nullptr_t) noexcept
             : m_(nullptr, cloner_type(), deleter_type())
         {
-            static_assert(!std::is_pointer<deleter_type>::value,
-               "constructed with null function pointer deleter");
-
-            static_assert(!std::is_pointer<cloner_type>::value,
-               "constructed with null function pointer cloner");
         }
 
         /**
@@ -54,14 +99,10 @@ namespace sutil
          *
          *  @param ptr The pointer to take ownership of.
          */
-        explicit value_ptr(T* ptr) noexcept
+        SUTIL_CONSTEXPR20 explicit value_ptr(T* ptr) noexcept
             : m_(ptr, cloner_type(), deleter_type())
         {
-            static_assert(!std::is_pointer<deleter_type>::value,
-               "constructed with null function pointer deleter");
-
-            static_assert(!std::is_pointer<cloner_type>::value,
-               "constructed with null function pointer cloner");
+            assert(policies_engaged());
         }
 
         /**
@@ -71,12 +112,11 @@ namespace sutil
          *  @param ptr The pointer to take ownership of.
          *  @param d A deleter.
          */
-        value_ptr(T* ptr, typename std::conditional <std::is_reference <deleter_type>::value,
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr, typename std::conditional <std::is_reference <deleter_type>::value,
                                                      deleter_type, const deleter_type&>::type d) noexcept
             : m_(ptr, cloner_type(), d)
         {
-            static_assert(!std::is_pointer<cloner_type>::value,
-               "constructed with null function pointer cloner");
+            assert(policies_engaged());
         }
 
         /**
@@ -86,11 +126,10 @@ namespace sutil
          *  @param ptr The pointer to take ownership of.
          *  @param d A deleter.
          */
-        value_ptr(T* ptr, typename std::remove_reference <deleter_type>::type&& d) noexcept
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr, typename std::remove_reference <deleter_type>::type&& d) noexcept
             : m_(std::move(ptr), cloner_type(), std::move(d))
         {
-            static_assert(!std::is_pointer<cloner_type>::value,
-               "constructed with null function pointer cloner");
+            assert(policies_engaged());
         }
 
         /**
@@ -100,12 +139,11 @@ namespace sutil
          *  @param ptr The pointer to take ownership of.
          *  @param c A cloner.
          */
-        value_ptr(T* ptr, typename std::conditional <std::is_reference <cloner_type>::value,
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr, typename std::conditional <std::is_reference <cloner_type>::value,
                                                      cloner_type, const cloner_type&>::type c) noexcept
             : m_(ptr, c, deleter_type())
         {
-            static_assert(!std::is_pointer<deleter_type>::value,
-               "constructed with null function pointer deleter");
+            assert(policies_engaged());
         }
 
         /**
@@ -115,11 +153,10 @@ namespace sutil
          *  @param ptr The pointer to take ownership of.
          *  @param c A cloner.
          */
-        value_ptr(T* ptr, typename std::remove_reference <cloner_type>::type&& c) noexcept
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr, typename std::remove_reference <cloner_type>::type&& c) noexcept
             : m_(std::move(ptr), std::move(c), deleter_type())
         {
-            static_assert(!std::is_pointer<deleter_type>::value,
-               "constructed with null function pointer cloner");
+            assert(policies_engaged());
         }
 
 
@@ -132,13 +169,14 @@ namespace sutil
          *  @param d A deleter.
          *  @param c A cloner.
          */
-        value_ptr(T* ptr,
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr,
                   typename std::conditional <std::is_reference <deleter_type>::value,
                                              deleter_type, const deleter_type&>::type d,
                   typename std::conditional <std::is_reference <cloner_type>::value,
                                              cloner_type, const cloner_type&>::type c) noexcept
             : m_(ptr, c, d)
         {
+            assert(policies_engaged());
         }
 
         /**
@@ -148,29 +186,56 @@ namespace sutil
          *  @param ptr The pointer to take ownership of.
          *  @param d A deleter.
          */
-        value_ptr(T* ptr,
+        SUTIL_CONSTEXPR20 value_ptr(T* ptr,
                   typename std::remove_reference <deleter_type>::type&& d,
                   typename std::remove_reference <cloner_type>::type&& c) noexcept
             : m_(std::move(ptr), std::move(c), std::move(d))
         {
+            assert(policies_engaged());
+        }
+
+        /**
+         *  Takes over the pointee and the deleter of a unique_ptr, without copying.
+         *
+         *  @param u The unique_ptr to take ownership from.
+         */
+        template <typename U, typename DeleterU, typename = takes_unique <U, DeleterU> >
+        explicit value_ptr(std::unique_ptr <U, DeleterU>&& u) noexcept
+            : m_(u.get(), cloner_type(), std::move(u.get_deleter()))
+        {
+            assert(policies_engaged());
+            u.release();
+        }
+
+        /**
+         *  Takes over the pointee and the deleter of a unique_ptr, without copying.
+         *  Also sets a cloner function.
+         *
+         *  @param u The unique_ptr to take ownership from.
+         *  @param c A cloner.
+         */
+        template <typename U, typename DeleterU, typename = takes_unique <U, DeleterU> >
+        explicit value_ptr(std::unique_ptr <U, DeleterU>&& u, cloner_type c) noexcept
+            : m_(u.get(), std::move(c), std::move(u.get_deleter()))
+        {
+            assert(policies_engaged());
+            u.release();
         }
 
         /**
          *  Moves a value ptr over. destroys previously held pointee.
          */
-        value_ptr(value_ptr&& v) noexcept
+        SUTIL_CONSTEXPR20 value_ptr(value_ptr&& v) noexcept
+            : m_(v.release(), std::move(v.get_cloner()), std::move(v.get_deleter()))
         {
-            reset(v.release());
-            get_deleter() = std::move(v.get_deleter());
-            get_cloner() = std::move(v.get_cloner());
         }
 
         /**
          *  Copies the pointee. Cannot be noexcept, because clone may throw.
          *  The value_ptr remains unaltered if clone throws.
          */
-        value_ptr(value_ptr const& v)
-            : m_(clone(v.get()), v.get_cloner(), v.get_deleter())
+        SUTIL_CONSTEXPR20 value_ptr(value_ptr const& v)
+            : m_(clone(v.get_cloner(), v.get()), v.get_cloner(), v.get_deleter())
         {
         }
 
@@ -179,17 +244,17 @@ namespace sutil
          *  The value_ptr remains unaltered if clone throws.
          */
         template <typename U, typename ClonerU, typename DeleterU>
-        value_ptr(value_ptr <U, ClonerU, DeleterU> const& v)
-            : m_(clone(v.get()), v.get_cloner(), v.get_deleter())
+        SUTIL_CONSTEXPR20 value_ptr(value_ptr <U, ClonerU, DeleterU> const& v)
+            : m_(clone(v.get_cloner(), v.get()), v.get_cloner(), v.get_deleter())
         {
         }
 
         /**
          *  Move assignment.
          */
-        value_ptr& operator=(value_ptr&& v)
+        SUTIL_CONSTEXPR20 value_ptr& operator=(value_ptr&& v)
         {
-            reset(v.release());
+            replace(v.release());
             get_deleter() = std::move(v.get_deleter());
             get_cloner() = std::move(v.get_cloner());
             return *this;
@@ -199,9 +264,9 @@ namespace sutil
          *  Move assignment
          */
         template <typename U, typename ClonerU, typename DeleterU>
-        value_ptr& operator=(value_ptr <U, ClonerU, DeleterU>&& v)
+        SUTIL_CONSTEXPR20 value_ptr& operator=(value_ptr <U, ClonerU, DeleterU>&& v)
         {
-            reset(v.release());
+            replace(v.release());
             get_deleter() = std::move(v.get_deleter());
             get_cloner() = std::move(v.get_cloner());
             return *this;
@@ -210,9 +275,9 @@ namespace sutil
         /**
          *  "Clone" assignment.
          */
-        value_ptr& operator=(value_ptr const& v)
+        SUTIL_CONSTEXPR20 value_ptr& operator=(value_ptr const& v)
         {
-            reset(clone(v.get()));
+            replace(clone(v.get_cloner(), v.get()));
             get_deleter() = v.get_deleter();
             get_cloner() = v.get_cloner();
             return *this;
@@ -222,19 +287,67 @@ namespace sutil
          *  "Clone" assignment
          */
         template <typename U, typename ClonerU, typename DeleterU>
-        value_ptr& operator=(value_ptr <U, ClonerU, DeleterU> const& v)
+        SUTIL_CONSTEXPR20 value_ptr& operator=(value_ptr <U, ClonerU, DeleterU> const& v)
         {
-            reset(clone(v.get()));
+            replace(clone(v.get_cloner(), v.get()));
             get_deleter() = v.get_deleter();
             get_cloner() = v.get_cloner();
             return *this;
         }
 
+        /**
+         *  Clones without using exceptions for allocation failure.
+         *  The cloner must be callable as cloner(ptr, error_code&), like nothrow_clone.
+         *
+         *  @param ec Set if cloning failed.
+         *  @return The copy, or an empty value_ptr if *this is empty or cloning failed.
+         */
+        value_ptr try_clone(std::error_code& ec) const
+        {
+            ec.clear();
+            pointer p = get() ? get_cloner()(get(), ec) : nullptr;
+            return value_ptr(p, get_deleter(), get_cloner());
+        }
+
+#if defined(__cpp_lib_expected)
+        /**
+         *  Clones without using exceptions for allocation failure.
+         *  The cloner must be callable as cloner(ptr, error_code&), like nothrow_clone.
+         */
+        std::expected <value_ptr, std::error_code> try_clone() const
+        {
+            std::error_code ec;
+            value_ptr result = try_clone(ec);
+            if (ec)
+                return std::unexpected(ec);
+            return result;
+        }
+#endif
+
+        /**
+         *  "Clone" assignment without using exceptions for allocation failure.
+         *  The value_ptr remains unaltered if cloning fails.
+         *  The cloner must be callable as cloner(ptr, error_code&), like nothrow_clone.
+         *
+         *  @return The error, if cloning failed.
+         */
+        std::error_code try_assign(value_ptr const& v)
+        {
+            std::error_code ec;
+            pointer p = v.get() ? v.get_cloner()(v.get(), ec) : nullptr;
+            if (ec)
+                return ec;
+            replace(p);
+            get_deleter() = v.get_deleter();
+            get_cloner() = v.get_cloner();
+            return ec;
+        }
+
         /**
          *  Replacing assignment, frees previously held object.
          *  Alternative to reset(ptr).
          */
-        value_ptr& operator=(T* ptr)
+        SUTIL_CONSTEXPR20 value_ptr& operator=(T* ptr)
         {
             reset(ptr);
             return *this;
@@ -243,7 +356,7 @@ namespace sutil
         /**
          *  Convenient dereferencing operator.
          */
-        typename std::add_lvalue_reference <element_type>::type operator*() const
+        SUTIL_CONSTEXPR20 typename std::add_lvalue_reference <element_type>::type operator*() const
         {
             // assert(get() != 0);
             return *get();
@@ -252,7 +365,7 @@ namespace sutil
         /**
          *  Convenient arrow operator.
          */
-        pointer operator->() const
+        SUTIL_CONSTEXPR20 pointer operator->() const
         {
             return get();
         }
@@ -260,7 +373,7 @@ namespace sutil
         /**
          *  Retrieves the held pointee.
          */
-        pointer get() const
+        SUTIL_CONSTEXPR20 pointer get() const
         {
             return std::get <0> (m_);
         }
@@ -268,7 +381,7 @@ namespace sutil
         /**
          *  Retrieves a reference to the deleter.
          */
-        typename std::add_lvalue_reference <deleter_type>::type
+        SUTIL_CONSTEXPR20 typename std::add_lvalue_reference <deleter_type>::type
         get_deleter() noexcept
         {
             return std::get <2> (m_);
@@ -277,13 +390,13 @@ namespace sutil
         /**
          *  Retrieves a reference to the deleter.
          */
-        typename std::add_lvalue_reference <typename std::add_const <deleter_type>::type>::type
+        SUTIL_CONSTEXPR20 typename std::add_lvalue_reference <typename std::add_const <deleter_type>::type>::type
         get_deleter() const noexcept
         {
             return std::get <2> (m_);
         }
 
-        typename std::add_lvalue_reference <cloner_type>::type
+        SUTIL_CONSTEXPR20 typename std::add_lvalue_reference <cloner_type>::type
         get_cloner() noexcept
         {
             return std::get <1> (m_);
@@ -292,7 +405,7 @@ namespace sutil
         /**
          *  Retrieves a reference to the cloner.
          */
-        typename std::add_lvalue_reference <typename std::add_const <cloner_type>::type>::type
+        SUTIL_CONSTEXPR20 typename std::add_lvalue_reference <typename std::add_const <cloner_type>::type>::type
         get_cloner() const noexcept
         {
             return std::get <1> (m_);
@@ -300,20 +413,18 @@ namespace sutil
 
         /**
          *  Resets the value_ptr with a new object. calls the deleter on the old object.
+         *  The held policies must be non-null if p is not.
          */
-        void reset(pointer p = pointer())
+        SUTIL_CONSTEXPR20 void reset(pointer p = pointer())
         {
-            if (p != get())
-            {
-                get_deleter()(get()); // delete held object.
-                std::get <0> (m_) = p;
-            }
+            replace(p);
+            assert(policies_engaged());
         }
 
         /**
          *  Is set? Does it hold something?
          */
-        explicit operator bool() const
+        SUTIL_CONSTEXPR20 explicit operator bool() const
         {
             return get() == nullptr ? false : true;
         }
@@ -322,17 +433,40 @@ namespace sutil
          *  Gets the owned object and disengages ownership.
          *  (I am not responsible for deleting it anymore, do it yourself).
          */
-        pointer release()
+        SUTIL_CONSTEXPR20 pointer release()
         {
             pointer p = get();
             std::get <0> (m_) = nullptr;
             return p;
         }
 
+        /**
+         *  Hands the pointee and the deleter over to a unique_ptr, without copying. The cloner is lost.
+         */
+        std::unique_ptr <T, DeleterT> to_unique() &&
+        {
+            std::unique_ptr <T, DeleterT> result(get(), std::move(get_deleter()));
+            release();
+            return result;
+        }
+
+        /**
+         *  Hands the pointee over to a shared_ptr, without copying. Allocates only the control block.
+         *  The deleter of the shared_ptr is a shared_value_deleter, which keeps the cloner:
+         *  std::get_deleter <shared_value_deleter <T, ClonerT, DeleterT> > (sp)->cloner.
+         *  The pointee is destroyed if allocating the control block throws.
+         */
+        std::shared_ptr <T> to_shared() &&
+        {
+            return std::shared_ptr <T> (release(), shared_value_deleter <T, ClonerT, DeleterT> {
+                std::move(get_cloner()), std::move(get_deleter())
+            });
+        }
+
         /**
          *  Swaps the pointee's.
          */
-        void swap(value_ptr&& v)
+        SUTIL_CONSTEXPR20 void swap(value_ptr&& v)
         {
             using std::swap;
             swap(m_, v.m_);
@@ -341,15 +475,31 @@ namespace sutil
         /**
          *  Destructor.
          */
-        ~value_ptr()
+        SUTIL_CONSTEXPR20 ~value_ptr()
         {
             reset();
         }
 
     private:
-        template <typename PtrT>
-        pointer clone(PtrT p) {
-            return p ? get_cloner()(p) : nullptr;
+        // reset, for callers that set the policies afterwards.
+        SUTIL_CONSTEXPR20 void replace(pointer p)
+        {
+            if (p != get())
+            {
+                if (get())
+                    get_deleter()(get()); // delete held object.
+                std::get <0> (m_) = p;
+            }
+        }
+
+        SUTIL_CONSTEXPR20 bool policies_engaged() const noexcept
+        {
+            return !get() || (detail::policy_engaged(get_cloner()) && detail::policy_engaged(get_deleter()));
+        }
+
+        template <typename ClonerU, typename PtrT>
+        static SUTIL_CONSTEXPR20 pointer clone(ClonerU const& c, PtrT p) {
+            return p ? c(p) : nullptr;
         }
 
     private:
@@ -357,7 +507,7 @@ namespace sutil
     };
 
     template <typename T, typename ClonerT = sutil::default_clone <T>, typename DeleterT = std::default_delete <T>, typename... List>
-    value_ptr <T, ClonerT, DeleterT> make_value(List&&... list)
+    SUTIL_CONSTEXPR20 value_ptr <T, ClonerT, DeleterT> make_value(List&&... list)
     {
         return value_ptr <T, ClonerT, DeleterT> (new T(std::forward <List> (list)...));
     }
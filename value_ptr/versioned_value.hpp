@@ -0,0 +1,265 @@
+#ifndef SIMPLE_UTIL_VERSIONED_VALUE_HPP_INCLUDED
+#define SIMPLE_UTIL_VERSIONED_VALUE_HPP_INCLUDED
+
+#include "cow_ptr.hpp"
+
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace sutil
+{
+    /**
+     *  A multi-version value for concurrent readers and writers.
+     *
+     *  Writers commit new versions one at a time. A commit copies the latest version, which shares the pointee,
+     *  and lets the writer modify it, so only the parts it touches are cloned through ClonerT.
+     *  Readers pin a version and read it without being disturbed by later commits. Pinning the latest version
+     *  takes no lock of the versioned_value, only an atomic shared_ptr load (which is not lock-free in every
+     *  standard library, libstdc++ guards it with a small striped lock). Looking up an older version by timestamp
+     *  takes a short registry lock.
+     *
+     *  A version is destroyed as soon as it is neither the latest nor pinned by any reader.
+     *  pin(ts) can therefore only find older versions that some reader still pins.
+     */
+    template <typename T, typename ClonerT = default_clone <T>, typename DeleterT = std::default_delete <T> >
+    class versioned_value
+    {
+    public:
+        using timestamp = std::uint64_t;
+        using value_type = cow_ptr <T, ClonerT, DeleterT>;
+
+    private:
+        struct version
+        {
+            timestamp ts;
+            value_type value;
+        };
+
+        using version_ptr = std::shared_ptr <version const>;
+        using registry_type = std::deque <std::pair <timestamp, std::weak_ptr <version const> > >;
+
+    public:
+        /**
+         *  A pinned version. Keeps the version alive while it exists.
+         */
+        class pinned
+        {
+        public:
+            /**
+             *  Creates an empty pin.
+             */
+            pinned() noexcept = default;
+
+            /**
+             *  Convenient dereferencing operator.
+             */
+            T const& operator*() const
+            {
+                return *version_->value;
+            }
+
+            /**
+             *  Convenient arrow operator.
+             */
+            T const* operator->() const noexcept
+            {
+                return version_->value.get();
+            }
+
+            /**
+             *  Retrieves the pinned value, shares the pointee.
+             */
+            value_type const& value() const noexcept
+            {
+                return version_->value;
+            }
+
+            /**
+             *  The commit timestamp of the pinned version.
+             */
+            timestamp version() const noexcept
+            {
+                return version_->ts;
+            }
+
+            /**
+             *  Is anything pinned?
+             */
+            explicit operator bool() const noexcept
+            {
+                return static_cast <bool> (version_);
+            }
+
+        private:
+            friend class versioned_value;
+
+            explicit pinned(version_ptr v) noexcept
+                : version_(std::move(v))
+            {
+            }
+
+        private:
+            version_ptr version_;
+        };
+
+        /**
+         *  Creates the first version, with timestamp 1.
+         */
+        explicit versioned_value(value_type initial)
+            : head_()
+            , write_mutex_()
+            , clock_(1)
+            , registry_mutex_()
+            , registry_()
+            , compact_at_(min_compact_size)
+        {
+            publish(std::make_shared <version const> (version{1, std::move(initial)}));
+        }
+
+        versioned_value(versioned_value const&) = delete;
+        versioned_value& operator=(versioned_value const&) = delete;
+
+        /**
+         *  Pins the latest version. Does not wait for writers, see the class comment on the atomic load.
+         */
+        pinned pin() const
+        {
+            return pinned(load());
+        }
+
+        /**
+         *  Pins the newest version committed at or before ts.
+         *  Returns an empty pin, if that version has already been collected.
+         */
+        pinned pin(timestamp ts) const
+        {
+            version_ptr latest = load();
+            if (latest->ts <= ts)
+                return pinned(std::move(latest));
+
+            std::lock_guard <std::mutex> lock(registry_mutex_);
+            for (auto i = registry_.rbegin(), end = registry_.rend(); i != end; ++i)
+            {
+                if (i->first <= ts)
+                    return pinned(i->second.lock());
+            }
+            return pinned();
+        }
+
+        /**
+         *  Commits a new version. Writers are serialized, readers are not blocked.
+         *
+         *  @param writer Called with a value_type& that shares the latest value. Use modify() on it to write.
+         *  @return The timestamp of the new version.
+         */
+        template <typename FunctionT>
+        timestamp commit(FunctionT&& writer)
+        {
+            std::lock_guard <std::mutex> lock(write_mutex_);
+            version_ptr latest = load();
+            value_type value = latest->value;
+            writer(value);
+            timestamp ts = clock_ + 1;
+            publish(std::make_shared <version const> (version{ts, std::move(value)}));
+            clock_ = ts;
+            return ts;
+        }
+
+        /**
+         *  Timestamp of the latest commit.
+         */
+        timestamp latest() const
+        {
+            return load()->ts;
+        }
+
+    private:
+        // the registry is compacted when it has grown to this size, then at twice its compacted size.
+        static constexpr std::size_t min_compact_size = 16;
+
+        void publish(version_ptr v)
+        {
+            {
+                std::lock_guard <std::mutex> lock(registry_mutex_);
+                prune();
+                registry_.emplace_back(v->ts, v);
+            }
+            store(std::move(v));
+        }
+
+        // drops the entries of collected versions, in place. Amortized constant per commit.
+        void prune()
+        {
+            // no version older than the front, so collected entries there need no marker.
+            while (!registry_.empty() && registry_.front().second.expired())
+                registry_.pop_front();
+            if (registry_.size() < compact_at_)
+                return;
+
+            // a run of collected entries after a live one is kept as one empty marker,
+            // so that pin(ts) does not return an older version for a timestamp inside the run.
+            auto out = registry_.begin();
+            for (auto in = registry_.begin(), end = registry_.end(); in != end; ++in)
+            {
+                if (!in->second.expired())
+                {
+                    if (out != in)
+                        *out = std::move(*in);
+                    ++out;
+                }
+                else if (out != registry_.begin() && !std::prev(out)->second.expired())
+                {
+                    out->first = in->first;
+                    out->second.reset();
+                    ++out;
+                }
+            }
+            registry_.erase(out, registry_.end());
+            compact_at_ = registry_.size() * 2 < min_compact_size ? min_compact_size : registry_.size() * 2;
+        }
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+        version_ptr load() const
+        {
+            return head_.load(std::memory_order_acquire);
+        }
+
+        void store(version_ptr v)
+        {
+            head_.store(std::move(v), std::memory_order_release);
+        }
+
+    private:
+        std::atomic <version_ptr> head_;
+#else
+        version_ptr load() const
+        {
+            return std::atomic_load_explicit(&head_, std::memory_order_acquire);
+        }
+
+        void store(version_ptr v)
+        {
+            std::atomic_store_explicit(&head_, std::move(v), std::memory_order_release);
+        }
+
+    private:
+        version_ptr head_;
+#endif
+        std::mutex write_mutex_;
+        timestamp clock_;
+        mutable std::mutex registry_mutex_;
+        registry_type registry_;
+        std::size_t compact_at_;
+    };
+
+    template <typename T, typename ClonerT, typename DeleterT>
+    constexpr std::size_t versioned_value <T, ClonerT, DeleterT>::min_compact_size;
+}
+
+#endif // SIMPLE_UTIL_VERSIONED_VALUE_HPP_INCLUDED